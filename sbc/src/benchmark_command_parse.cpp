@@ -0,0 +1,192 @@
+// benchmark_command_parse.cpp - Cost of parsing and validating incoming commands
+//
+// For every command in protocol/commands.json two requests are generated: one
+// with every parameter filled in and one with only the required parameters
+// (what a ground station usually sends). Each is put through:
+//   dom - json::parse into a full document, then the envelope checks done
+//         with contains()/operator[] lookups (the previous front end)
+//   sax - scanCommandHeader + validateCommandHeader, which builds a DOM only
+//         for the payload's parameters (the current front end)
+// Both end with the payload a handler would be given. Reports mean time per
+// message and whether the payload carried anything beyond the command name.
+//
+// Usage: benchmark_command_parse [path/to/commands.json] [iterations]
+
+#include <chrono>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "config.h"
+#include "protocol/command_header.h"
+#include "protocol/wire_format.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// Representative value for a parameter spec
+json sampleParameter(const json& spec) {
+    if (spec.contains("default")) {
+        return spec["default"];
+    }
+    if (spec.contains("enum") && !spec["enum"].empty()) {
+        return spec["enum"][0];
+    }
+
+    std::string type = spec.value("type", "string");
+    if (type == "integer") {
+        return spec.value("minimum", 1);
+    }
+    if (type == "number") {
+        return 1.5;
+    }
+    if (type == "boolean") {
+        return true;
+    }
+    if (type == "array") {
+        return json::array({"iso", "shutter_speed", "aperture", "white_balance"});
+    }
+    return "1/250";
+}
+
+// Previous front end: full document, then envelope lookups
+bool parseWithDom(const std::string& text, std::string& command, std::string& error) {
+    json msg = json::parse(text);
+
+    if (!msg.contains("protocol_version")) {
+        error = "Missing protocol_version";
+        return false;
+    }
+    if (msg["protocol_version"] != config::PROTOCOL_VERSION) {
+        error = "Invalid protocol version";
+        return false;
+    }
+    if (!msg.contains("message_type") || !msg.contains("sequence_id") || !msg.contains("payload")) {
+        error = "Missing field";
+        return false;
+    }
+    if (!msg["payload"].contains("command")) {
+        error = "Missing command in payload";
+        return false;
+    }
+
+    command = msg["payload"]["command"].get<std::string>();
+    json payload = std::move(msg["payload"]);
+    return msg["sequence_id"].get<int>() >= 0 && payload.is_object();
+}
+
+// Current front end: header scan, DOM for the payload fields only
+bool parseWithSax(const std::string& text, std::string& command, std::string& error, bool& has_fields) {
+    CommandHeader header;
+    if (!scanCommandHeader(text, wire::Encoding::JSON, header, error) ||
+        !validateCommandHeader(header, error)) {
+        return false;
+    }
+
+    has_fields = header.needs_document;
+    command = header.command;
+    json payload = header.takePayload();
+    return payload.is_object();
+}
+
+double timeUs(int iterations, const std::function<bool()>& run) {
+    size_t ok = 0;  // Keeps the optimiser from discarding the work
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        ok += run() ? 1 : 0;
+    }
+    auto end = Clock::now();
+
+    if (ok != static_cast<size_t>(iterations)) {
+        std::cerr << "unexpected validation failure" << std::endl;
+    }
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "../../protocol/commands.json";
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 50000;
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << path << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [path/to/commands.json] [iterations]" << std::endl;
+        return 1;
+    }
+
+    json spec;
+    try {
+        file >> spec;
+    } catch (const json::exception& e) {
+        std::cerr << "Failed to parse " << path << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Command parse + validate benchmark (" << iterations << " iterations per measurement)" << std::endl;
+    std::cout << "Times are per message; 'fields' shows whether the payload carried parameters" << std::endl;
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(26) << "command" << std::setw(10) << "params"
+              << std::right << std::setw(7) << "bytes" << std::setw(10) << "dom us"
+              << std::setw(10) << "sax us" << std::setw(9) << "speedup" << std::setw(10) << "fields"
+              << std::endl;
+    std::cout << std::string(82, '-') << std::endl;
+
+    double dom_total = 0.0;
+    double sax_total = 0.0;
+    int seq_id = 1;
+
+    for (const auto& entry : spec["commands"].items()) {
+        const std::string& name = entry.key();
+        const json& command = entry.value();
+
+        json all = json::object();
+        json required = json::object();
+        if (command.contains("parameters") && command["parameters"].is_object()) {
+            for (const auto& param : command["parameters"].items()) {
+                all[param.key()] = sampleParameter(param.value());
+                if (param.value().value("required", false)) {
+                    required[param.key()] = all[param.key()];
+                }
+            }
+        }
+
+        const std::pair<const char*, const json*> variants[] = {
+            {"all", &all},
+            {"required", &required}
+        };
+
+        for (const auto& variant : variants) {
+            std::string text = json({
+                {"protocol_version", config::PROTOCOL_VERSION},
+                {"message_type", "command"},
+                {"sequence_id", seq_id++},
+                {"timestamp", 1729085123},
+                {"payload", {{"command", name}, {"parameters", *variant.second}}}
+            }).dump();
+
+            std::string out;
+            std::string error;
+            bool has_fields = false;
+
+            double dom_us = timeUs(iterations, [&]() { return parseWithDom(text, out, error); });
+            double sax_us = timeUs(iterations, [&]() { return parseWithSax(text, out, error, has_fields); });
+            dom_total += dom_us;
+            sax_total += sax_us;
+
+            std::cout << std::left << std::setw(26) << name << std::setw(10) << variant.first
+                      << std::right << std::setw(7) << text.size()
+                      << std::setw(10) << std::fixed << std::setprecision(2) << dom_us
+                      << std::setw(10) << sax_us
+                      << std::setw(8) << std::setprecision(1) << (dom_us / sax_us) << "x"
+                      << std::setw(10) << (has_fields ? "yes" : "no") << std::endl;
+        }
+    }
+
+    std::cout << std::string(82, '-') << std::endl;
+    std::cout << "mean speedup over all requests: " << std::fixed << std::setprecision(2)
+              << (dom_total / sax_total) << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+// benchmark_encoding.cpp - Compare wire encodings for the TCP command protocol
+//
+// For every command in protocol/commands.json a representative request and
+// success response are generated from the spec, then each is encoded and
+// decoded as JSON, CBOR and MessagePack. Reports bytes on the wire (including
+// framing) and mean encode/decode time per message.
+//
+// Usage: benchmark_encoding [path/to/commands.json] [iterations]
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "config.h"
+#include "protocol/messages.h"
+#include "protocol/wire_format.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// Representative value for a parameter spec
+json sampleParameter(const json& spec) {
+    if (spec.contains("default")) {
+        return spec["default"];
+    }
+    if (spec.contains("enum") && !spec["enum"].empty()) {
+        return spec["enum"][0];
+    }
+
+    std::string type = spec.value("type", "string");
+    if (type == "integer") {
+        return spec.value("minimum", 1);
+    }
+    if (type == "number") {
+        return 1.5;
+    }
+    if (type == "boolean") {
+        return true;
+    }
+    if (type == "array") {
+        return json::array({"iso", "shutter_speed", "aperture", "white_balance"});
+    }
+    return "1/250";
+}
+
+// Representative value for a response field described as "string", "float", ...
+json sampleResult(const json& value) {
+    if (!value.is_string()) {
+        return value;
+    }
+
+    std::string type = value.get<std::string>();
+    if (type.rfind("integer", 0) == 0) return 1729085123;
+    if (type.rfind("float", 0) == 0)   return 42.75;
+    if (type.rfind("boolean", 0) == 0) return true;
+    if (type.rfind("string", 0) == 0)  return "DSC09876.JPG";
+    if (type.rfind("any", 0) == 0)     return "800";
+    if (type.rfind("object", 0) == 0) {
+        return {{"iso", "800"}, {"shutter_speed", "1/250"}, {"aperture", "f/2.8"}, {"white_balance", "auto"}};
+    }
+    return type;  // Literal value (e.g. "captured")
+}
+
+struct Measurement {
+    size_t bytes = 0;
+    double encode_us = 0.0;
+    double decode_us = 0.0;
+};
+
+Measurement measure(const json& message, wire::Encoding encoding, int iterations) {
+    Measurement m;
+    std::string frame = wire::encode(message, encoding);
+    m.bytes = frame.size();
+
+    // Body without framing, as handed to decode() by the frame reader
+    std::string_view body(frame);
+    if (wire::isBinary(encoding)) {
+        body.remove_prefix(wire::LENGTH_PREFIX_SIZE);
+    } else {
+        body.remove_suffix(1);
+    }
+
+    size_t sink = 0;  // Keeps the optimiser from discarding the work
+
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        sink += wire::encode(message, encoding).size();
+    }
+    auto mid = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        sink += wire::decode(body, encoding).size();
+    }
+    auto end = Clock::now();
+
+    m.encode_us = std::chrono::duration<double, std::micro>(mid - start).count() / iterations;
+    m.decode_us = std::chrono::duration<double, std::micro>(end - mid).count() / iterations;
+
+    if (sink == 0) {
+        std::cerr << "unexpected empty output" << std::endl;
+    }
+    return m;
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "../../protocol/commands.json";
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 20000;
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << path << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [path/to/commands.json] [iterations]" << std::endl;
+        return 1;
+    }
+
+    json spec;
+    try {
+        file >> spec;
+    } catch (const json::exception& e) {
+        std::cerr << "Failed to parse " << path << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    const wire::Encoding encodings[] = {wire::Encoding::JSON, wire::Encoding::CBOR, wire::Encoding::MSGPACK};
+
+    std::cout << "Wire encoding benchmark (" << iterations << " iterations per measurement)" << std::endl;
+    std::cout << "Bytes include framing (newline or 4-byte length prefix); times are per message" << std::endl;
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(24) << "command" << std::setw(10) << "message"
+              << std::setw(10) << "encoding" << std::right << std::setw(8) << "bytes"
+              << std::setw(9) << "vs json" << std::setw(12) << "encode us" << std::setw(12) << "decode us"
+              << std::endl;
+    std::cout << std::string(85, '-') << std::endl;
+
+    size_t totals[3] = {0, 0, 0};
+    int seq_id = 1;
+
+    for (const auto& entry : spec["commands"].items()) {
+        const std::string& name = entry.key();
+        const json& command = entry.value();
+
+        json parameters = json::object();
+        if (command.contains("parameters") && command["parameters"].is_object()) {
+            for (const auto& param : command["parameters"].items()) {
+                parameters[param.key()] = sampleParameter(param.value());
+            }
+        }
+
+        json request = {
+            {"protocol_version", config::PROTOCOL_VERSION},
+            {"message_type", "command"},
+            {"sequence_id", seq_id},
+            {"timestamp", 1729085123},
+            {"payload", {{"command", name}, {"parameters", parameters}}}
+        };
+
+        json result = json::object();
+        if (command.contains("response") && command["response"].is_object() &&
+            command["response"].contains("success") && command["response"]["success"].is_object()) {
+            for (const auto& field : command["response"]["success"].items()) {
+                result[field.key()] = sampleResult(field.value());
+            }
+        }
+        json response = messages::createSuccessResponse(seq_id, name, result);
+        ++seq_id;
+
+        const std::pair<const char*, const json*> messages_to_test[] = {
+            {"request", &request},
+            {"response", &response}
+        };
+
+        for (const auto& message : messages_to_test) {
+            size_t json_bytes = 0;
+            for (size_t i = 0; i < 3; ++i) {
+                Measurement m = measure(*message.second, encodings[i], iterations);
+                if (i == 0) {
+                    json_bytes = m.bytes;
+                }
+                totals[i] += m.bytes;
+
+                std::cout << std::left << std::setw(24) << name << std::setw(10) << message.first
+                          << std::setw(10) << wire::encodingToString(encodings[i]) << std::right
+                          << std::setw(8) << m.bytes
+                          << std::setw(8) << std::fixed << std::setprecision(0)
+                          << (100.0 * m.bytes / json_bytes) << "%"
+                          << std::setw(12) << std::setprecision(2) << m.encode_us
+                          << std::setw(12) << m.decode_us << std::endl;
+            }
+        }
+    }
+
+    std::cout << std::string(85, '-') << std::endl;
+    for (size_t i = 0; i < 3; ++i) {
+        std::cout << std::left << std::setw(10) << wire::encodingToString(encodings[i]) << std::right
+                  << "total " << totals[i] << " bytes ("
+                  << std::fixed << std::setprecision(0) << (100.0 * totals[i] / totals[0]) << "% of json)"
+                  << std::endl;
+    }
+
+    return 0;
+}
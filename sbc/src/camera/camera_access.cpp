@@ -0,0 +1,117 @@
+#include "camera/camera_access.h"
+
+namespace {
+thread_local CameraAccess::Priority current_priority = CameraAccess::Priority::PROPERTY;
+thread_local CameraAccess::Usage usage;
+}
+
+CameraAccess::PriorityScope::PriorityScope(Priority priority)
+    : previous_(current_priority) {
+    current_priority = priority;
+}
+
+CameraAccess::PriorityScope::~PriorityScope() {
+    current_priority = previous_;
+}
+
+CameraAccess::Priority CameraAccess::currentPriority() {
+    return current_priority;
+}
+
+CameraAccess::Usage& CameraAccess::threadUsage() {
+    return usage;
+}
+
+bool CameraAccess::availableTo(std::thread::id self, Priority priority) const {
+    if (depth_ > 0) {
+        return owner_ == self;
+    }
+
+    // Free - but more urgent waiters go first
+    for (int p = 0; p < static_cast<int>(priority); ++p) {
+        if (waiting_[p] > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CameraAccess::acquire(std::thread::id self) {
+    owner_ = self;
+    if (depth_++ == 0) {
+        held_since_ = std::chrono::steady_clock::now();
+    }
+}
+
+void CameraAccess::lock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::thread::id self = std::this_thread::get_id();
+    Priority priority = current_priority;
+
+    if (!availableTo(self, priority)) {
+        auto start = std::chrono::steady_clock::now();
+        int& waiting = waiting_[static_cast<int>(priority)];
+        ++waiting;
+        released_.wait(lock, [this, self, priority] { return availableTo(self, priority); });
+        --waiting;
+        usage.waited += std::chrono::steady_clock::now() - start;
+    }
+
+    acquire(self);
+}
+
+bool CameraAccess::try_lock() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::thread::id self = std::this_thread::get_id();
+
+    if (!availableTo(self, current_priority)) {
+        return false;
+    }
+
+    acquire(self);
+    return true;
+}
+
+bool CameraAccess::try_lock_for(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::thread::id self = std::this_thread::get_id();
+    Priority priority = current_priority;
+
+    if (!availableTo(self, priority)) {
+        auto start = std::chrono::steady_clock::now();
+        int& waiting = waiting_[static_cast<int>(priority)];
+        ++waiting;
+        bool granted = released_.wait_for(lock, timeout,
+                                          [this, self, priority] { return availableTo(self, priority); });
+        --waiting;
+        usage.waited += std::chrono::steady_clock::now() - start;
+
+        if (!granted) {
+            // Our place in line may have been holding back a lower class
+            lock.unlock();
+            released_.notify_all();
+            return false;
+        }
+    }
+
+    acquire(self);
+    return true;
+}
+
+void CameraAccess::unlock() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--depth_ > 0) {
+            return;
+        }
+        owner_ = std::thread::id();
+        usage.held += std::chrono::steady_clock::now() - held_since_;
+    }
+    // Wake every class - each waiter re-checks whether it is next
+    released_.notify_all();
+}
+
+bool CameraAccess::heldByCurrentThread() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return depth_ > 0 && owner_ == std::this_thread::get_id();
+}
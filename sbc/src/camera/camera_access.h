@@ -0,0 +1,82 @@
+#ifndef CAMERA_ACCESS_H
+#define CAMERA_ACCESS_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Exclusive access to the camera SDK
+// Satisfies Lockable, so it is used with std::lock_guard / std::unique_lock
+// exactly like the std::mutex it replaces. The owning thread may re-enter
+// it, which lets a caller hold access across several camera operations
+// (e.g. a command batch) while each operation still takes its own lock.
+//
+// Access is granted by priority rather than arrival order: when the camera
+// is released, the most urgent waiting class goes next, and a lower class
+// cannot take access (not even with try_lock) while a higher class waits.
+// A capture therefore waits for at most the SDK call already in progress.
+class CameraAccess {
+public:
+    // Priority classes, most urgent first
+    enum class Priority {
+        CAPTURE,      // Shutter, focus, AF - latency-critical
+        PROPERTY,     // User property reads/writes (default)
+        BACKGROUND    // Periodic refresh - yields to everything else
+    };
+
+    // Sets the priority class of the calling thread's camera access for
+    // its lifetime. Scopes nest; the previous class is restored on exit.
+    class PriorityScope {
+    public:
+        explicit PriorityScope(Priority priority);
+        ~PriorityScope();
+
+        PriorityScope(const PriorityScope&) = delete;
+        PriorityScope& operator=(const PriorityScope&) = delete;
+
+    private:
+        Priority previous_;
+    };
+
+    // Time the calling thread spent waiting for and holding access, summed
+    // over its lock() calls since reset (re-entrant locks count once)
+    struct Usage {
+        std::chrono::nanoseconds waited{0};
+        std::chrono::nanoseconds held{0};
+    };
+    static Usage& threadUsage();
+
+    CameraAccess() = default;
+    CameraAccess(const CameraAccess&) = delete;
+    CameraAccess& operator=(const CameraAccess&) = delete;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    // Wait up to timeout for access
+    bool try_lock_for(std::chrono::milliseconds timeout);
+
+    // True if the calling thread currently holds access
+    bool heldByCurrentThread() const;
+
+    // Priority class of the calling thread
+    static Priority currentPriority();
+
+private:
+    static constexpr int PRIORITY_COUNT = 3;
+
+    // Caller must hold mutex_
+    bool availableTo(std::thread::id self, Priority priority) const;
+    void acquire(std::thread::id self);
+
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+    std::thread::id owner_;
+    int depth_ = 0;
+    std::chrono::steady_clock::time_point held_since_;
+    int waiting_[PRIORITY_COUNT] = {};  // Blocked threads per priority class
+};
+
+#endif // CAMERA_ACCESS_H
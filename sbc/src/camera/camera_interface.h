@@ -2,6 +2,8 @@
 #define CAMERA_INTERFACE_H
 
 #include <string>
+#include <functional>
+#include "camera/camera_access.h"
 #include "protocol/messages.h"
 
 // Abstract camera interface
@@ -48,6 +50,18 @@ public:
     virtual bool setProperty(const std::string& property, const std::string& value) = 0;
     virtual std::string getProperty(const std::string& property) const = 0;
 
+    // Property change notifications
+    // The callback receives (property, value) whenever a value the camera
+    // reads differs from its cached copy (periodic refresh, get/set). It is
+    // called on the thread that noticed the change and must not block.
+    using PropertyChangeCallback = std::function<void(const std::string& property, const std::string& value)>;
+    virtual void setPropertyChangeCallback(PropertyChangeCallback callback) = 0;
+
+    // SDK access lock. Every operation above takes it for its own duration;
+    // holding it across several calls makes them run back to back with no
+    // other thread (e.g. the property refresh) touching the camera in between.
+    virtual CameraAccess& access() const = 0;
+
     // Phase 2: Additional methods for camera control
     // virtual bool startRecording() = 0;
     // virtual bool stopRecording() = 0;
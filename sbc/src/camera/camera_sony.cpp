@@ -3,7 +3,9 @@
 
 #include "camera/camera_interface.h"
 #include "camera/property_loader.h"
+#include "protocol/command_deadline.h"
 #include "utils/logger.h"
+#include "config.h"
 #include <memory>
 #include <atomic>
 #include <mutex>
@@ -28,6 +30,18 @@ static std::string toHexString(uint64_t value) {
     return oss.str();
 }
 
+// Checked once camera access is granted: the wait for it can outlast the
+// command's deadline, and a late shutter or focus move is worse than none
+static bool expiredWaitingForCamera(const std::string& what) {
+    int64_t overdue_ms = 0;
+    if (!deadline::expired(&overdue_ms)) {
+        return false;
+    }
+    Logger::warning("Cannot " + what + ": command expired " + std::to_string(overdue_ms) +
+                    "ms ago while waiting for the camera");
+    return true;
+}
+
 // Sony camera callback handler
 class SonyCameraCallback : public SDK::IDeviceCallback
 {
@@ -97,7 +111,7 @@ public:
     }
 
     bool connect() override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<CameraAccess> lock(mutex_);
 
         if (!sdk_initialized_) {
             Logger::error("Cannot connect: SDK not initialized");
@@ -219,7 +233,7 @@ public:
         // Stop property refresh thread first (before acquiring lock)
         stopPropertyRefresh();
 
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<CameraAccess> lock(mutex_);
 
         if (!isConnectedLocked()) {
             return;
@@ -275,8 +289,10 @@ public:
         }
 
         // Try to get device handle and model without blocking
+        // (background class - never taken while a command is waiting)
         {
-            std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+            CameraAccess::PriorityScope background(CameraAccess::Priority::BACKGROUND);
+            std::unique_lock<CameraAccess> lock(mutex_, std::try_to_lock);
             if (!lock.owns_lock()) {
                 // Couldn't get lock - return cached status (never blocks)
                 cached_status_.connected = connected;
@@ -307,11 +323,16 @@ public:
 
         // Acquire lock for entire operation to prevent concurrent SDK access
         // CRITICAL FIX: Keep lock held during SDK calls to avoid race condition
-        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
-        if (!lock.owns_lock()) {
+        // Highest priority: jumps ahead of property traffic and background refresh
+        CameraAccess::PriorityScope urgent(CameraAccess::Priority::CAPTURE);
+        std::unique_lock<CameraAccess> lock(mutex_, std::defer_lock);
+        if (!lock.try_lock_for(std::chrono::milliseconds(config::CAMERA_ACCESS_TIMEOUT_MS))) {
             Logger::warning("Cannot capture: camera busy with another operation");
             return false;
         }
+        if (expiredWaitingForCamera("capture")) {
+            return false;
+        }
 
         Logger::info("Triggering shutter release...");
 
@@ -361,11 +382,16 @@ public:
         }
 
         // Acquire lock for entire operation to prevent concurrent SDK access
-        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
-        if (!lock.owns_lock()) {
+        // Highest priority: jumps ahead of property traffic and background refresh
+        CameraAccess::PriorityScope urgent(CameraAccess::Priority::CAPTURE);
+        std::unique_lock<CameraAccess> lock(mutex_, std::defer_lock);
+        if (!lock.try_lock_for(std::chrono::milliseconds(config::CAMERA_ACCESS_TIMEOUT_MS))) {
             Logger::warning("Cannot focus: camera busy with another operation");
             return false;
         }
+        if (expiredWaitingForCamera("focus")) {
+            return false;
+        }
 
         // CRITICAL FIX #1: Query Focus_Speed_Range to determine valid speed values
         // The SDK may reject focus operations if speed is outside the camera's supported range
@@ -591,11 +617,16 @@ public:
         }
 
         // Acquire lock for entire operation to prevent concurrent SDK access
-        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
-        if (!lock.owns_lock()) {
+        // Highest priority: jumps ahead of property traffic and background refresh
+        CameraAccess::PriorityScope urgent(CameraAccess::Priority::CAPTURE);
+        std::unique_lock<CameraAccess> lock(mutex_, std::defer_lock);
+        if (!lock.try_lock_for(std::chrono::milliseconds(config::CAMERA_ACCESS_TIMEOUT_MS))) {
             Logger::warning("Cannot trigger auto-focus hold: camera busy with another operation");
             return false;
         }
+        if (expiredWaitingForCamera("trigger auto-focus hold")) {
+            return false;
+        }
 
         // Map state string to Sony SDK PushAutoFocus values
         CrInt16 af_value;
@@ -637,7 +668,7 @@ public:
         }
 
         // Acquire lock (this is a const method but we need thread safety)
-        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        std::unique_lock<CameraAccess> lock(mutex_, std::try_to_lock);
         if (!lock.owns_lock()) {
             Logger::warning("Cannot read focal distance: camera busy");
             return -1.0f;
@@ -858,8 +889,10 @@ private:
 
         static int cached_battery = 75;
 
-        // Try to acquire lock without blocking
-        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        // Try to acquire lock without blocking (background class - skipped
+        // whenever a command is waiting for the camera)
+        CameraAccess::PriorityScope background(CameraAccess::Priority::BACKGROUND);
+        std::unique_lock<CameraAccess> lock(mutex_, std::try_to_lock);
         if (!lock.owns_lock()) {
             // Can't get lock - return cached value
             return cached_battery;
@@ -923,11 +956,15 @@ private:
         // Acquire lock for entire operation to prevent concurrent SDK access
         // CRITICAL FIX: Keep lock held during SDK call to avoid race condition
         // with getProperty() and getBatteryLevel()
-        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
-        if (!lock.owns_lock()) {
+        // Waits behind capture/focus, ahead of background refresh
+        std::unique_lock<CameraAccess> lock(mutex_, std::defer_lock);
+        if (!lock.try_lock_for(std::chrono::milliseconds(config::CAMERA_ACCESS_TIMEOUT_MS))) {
             Logger::warning("Cannot set property: camera busy with another operation");
             return false;
         }
+        if (expiredWaitingForCamera("set property")) {
+            return false;
+        }
 
         // Do property mapping while holding lock
         SDK::CrDeviceProperty prop;
@@ -1240,7 +1277,7 @@ private:
     }
 
     std::string getProperty(const std::string& property) const override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<CameraAccess> lock(mutex_);
 
         if (!isConnectedLocked()) {
             Logger::error("Cannot get property: camera not connected");
@@ -1440,9 +1477,44 @@ private:
         }
 
         Logger::debug("Camera property " + property + " = " + result);
+        cacheProperty(property, result);
         return result;
     }
 
+    void setPropertyChangeCallback(PropertyChangeCallback callback) override {
+        // cacheProperty() runs under the same lock (refresh may already be running)
+        std::lock_guard<CameraAccess> lock(mutex_);
+        property_changed_ = std::move(callback);
+    }
+
+    // Record a value read from the camera in the status cache, reporting it
+    // if it changed (caller holds mutex_)
+    void cacheProperty(const std::string& property, const std::string& value) const {
+        std::string* cached = nullptr;
+        if (property == "iso") {
+            cached = &cached_status_.iso;
+        } else if (property == "shutter_speed") {
+            cached = &cached_status_.shutter_speed;
+        } else if (property == "aperture") {
+            cached = &cached_status_.aperture;
+        } else if (property == "white_balance") {
+            cached = &cached_status_.white_balance;
+        } else if (property == "focus_mode") {
+            cached = &cached_status_.focus_mode;
+        } else if (property == "file_format") {
+            cached = &cached_status_.file_format;
+        }
+
+        if (!cached || *cached == value) {
+            return;
+        }
+
+        *cached = value;
+        if (property_changed_) {
+            property_changed_(property, value);
+        }
+    }
+
     // Update cached camera properties for status broadcasts
     void updateCachedProperties() {
         Logger::info("updateCachedProperties: Entry");
@@ -1453,18 +1525,18 @@ private:
 
         Logger::info("updateCachedProperties: Querying properties...");
         // NOTE: No mutex lock needed here - getProperty() acquires it for each call
-        // Query current camera settings and update cache
-        cached_status_.iso = getProperty("iso");
+        // and stores the value in the cache (reporting changes to subscribers)
+        getProperty("iso");
         Logger::info("updateCachedProperties: Got ISO");
-        cached_status_.shutter_speed = getProperty("shutter_speed");
+        getProperty("shutter_speed");
         Logger::info("updateCachedProperties: Got shutter_speed");
-        cached_status_.aperture = getProperty("aperture");
+        getProperty("aperture");
         Logger::info("updateCachedProperties: Got aperture");
-        cached_status_.white_balance = getProperty("white_balance");
+        getProperty("white_balance");
         Logger::info("updateCachedProperties: Got white_balance");
-        cached_status_.focus_mode = getProperty("focus_mode");
+        getProperty("focus_mode");
         Logger::info("updateCachedProperties: Got focus_mode");
-        cached_status_.file_format = getProperty("file_format");
+        getProperty("file_format");
         Logger::info("updateCachedProperties: Got file_format");
 
         Logger::info("Updated cached camera properties: ISO=" + cached_status_.iso +
@@ -1472,8 +1544,12 @@ private:
                     ", Aperture=" + cached_status_.aperture);
     }
 
+    CameraAccess& access() const override {
+        return mutex_;
+    }
+
 private:
-    mutable std::mutex mutex_;
+    mutable CameraAccess mutex_;   // Serialises all SDK access (re-entrant for the holder)
     bool sdk_initialized_;
     SDK::CrDeviceHandle device_handle_;
     std::unique_ptr<SonyCameraCallback> callback_;
@@ -1483,6 +1559,9 @@ private:
     // Cached status for non-blocking getStatus() calls
     mutable messages::CameraStatus cached_status_;
 
+    // Subscriber hook for cached property changes
+    PropertyChangeCallback property_changed_;
+
     // Periodic property refresh
     std::atomic<bool> property_refresh_running_{false};
     std::thread property_refresh_thread_;
@@ -1491,6 +1570,10 @@ private:
     void propertyRefreshLoop() {
         Logger::info("Camera property refresh thread started (interval: 2 seconds)");
 
+        // Lowest priority - each getProperty() waits until no command wants
+        // the camera, so a capture never waits on more than one property read
+        CameraAccess::PriorityScope background(CameraAccess::Priority::BACKGROUND);
+
         while (property_refresh_running_) {
             if (isConnected()) {
                 try {
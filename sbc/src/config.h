@@ -9,6 +9,7 @@ namespace config {
     constexpr int TCP_PORT = 5000;
     constexpr int UDP_STATUS_PORT = 5001;
     constexpr int UDP_HEARTBEAT_PORT = 5002;
+    constexpr int UDP_COMMAND_PORT = 5003;       // Reliable UDP command channel
 
     // Alternative UDP ports (for Windows Tools with firewall restrictions)
     constexpr int UDP_STATUS_PORT_ALT = 50001;
@@ -29,10 +30,27 @@ namespace config {
     }
 
     // Timing configuration
-    constexpr int STATUS_INTERVAL_MS = 200;      // 5 Hz
+    constexpr int STATUS_INTERVAL_MS = 200;      // 5 Hz - status rate while nothing is happening
+    constexpr int STATUS_KEYFRAME_INTERVAL_MS = 5000;  // Delta status stream: full status this often
     constexpr int HEARTBEAT_INTERVAL_MS = 1000;  // 1 Hz
     constexpr int HEARTBEAT_TIMEOUT_SEC = 10;
 
+    // Adaptive status rate: faster while camera status is changing (settings
+    // being adjusted, a capture sequence), slower once it has been still for
+    // a while, and slower again when ground heartbeats show a poor link.
+    constexpr int STATUS_INTERVAL_ACTIVE_MS = 100;   // 10 Hz ceiling
+    constexpr int STATUS_INTERVAL_IDLE_MS = 1000;    // 1 Hz
+    constexpr int STATUS_INTERVAL_MAX_MS = 2000;     // Slowest, with link backoff
+    // Older system snapshots are re-read on demand - kept well above the
+    // slowest broadcast so readers never miss the broadcaster's snapshot
+    constexpr int SYSTEM_STATUS_MAX_AGE_MS = 2 * STATUS_INTERVAL_MAX_MS;
+    constexpr int STATUS_ACTIVE_HOLD_MS = 2000;      // Stay fast this long after a change
+    constexpr int STATUS_IDLE_AFTER_MS = 10000;      // Go idle after this long without one
+    constexpr double LINK_LOSS_DEGRADED = 0.1;       // Heartbeat loss that doubles the interval
+    constexpr double LINK_LOSS_POOR = 0.3;           // ...and quadruples it
+    constexpr int LINK_RTT_DEGRADED_MS = 300;
+    constexpr int LINK_RTT_POOR_MS = 800;
+
     // Protocol configuration
     constexpr const char* PROTOCOL_VERSION = "1.0";
     constexpr const char* SERVER_ID = "payload_manager";
@@ -44,14 +62,124 @@ namespace config {
     // Buffer sizes
     constexpr int TCP_BUFFER_SIZE = 8192;
     constexpr int UDP_BUFFER_SIZE = 4096;
-    constexpr int MAX_TCP_CLIENTS = 5;
-
-    // Capabilities (Phase 1)
-    constexpr const char* CAPABILITIES[] = {
-        "handshake",
-        "system.get_status"
-    };
-    constexpr int CAPABILITIES_COUNT = 2;
+    constexpr int MAX_TCP_CLIENTS = 5;           // Further connections are refused at accept
+    constexpr int TCP_LISTEN_BACKLOG = 64;       // Absorbs reconnect storms until accept runs
+
+    // Local command endpoint (Unix domain socket) for processes on the SBC,
+    // e.g. a flight-controller bridge or mission script. Same protocol and
+    // dispatch as TCP, without the loopback TCP stack, and its clients do not
+    // take MAX_TCP_CLIENTS slots. Peers must run as root, as our user or in
+    // our group, primary or supplementary (SO_PEERCRED / SO_PEERGROUPS).
+    // Set DPM_LOCAL_SOCKET to override the path, or to "" to disable it.
+    constexpr const char* LOCAL_SOCKET_PATH = "/run/dpm/payload_manager.sock";
+    constexpr int MAX_LOCAL_CLIENTS = 8;
+
+    inline std::string getLocalSocketPath() {
+        const char* env_path = std::getenv("DPM_LOCAL_SOCKET");
+        if (env_path != nullptr) {
+            return std::string(env_path);
+        }
+        return LOCAL_SOCKET_PATH;
+    }
+
+    // UDP command channel - an alternative to TCP for lossy radio links, so
+    // one lost segment cannot hold up every command behind it. One JSON
+    // message per datagram, same schema as TCP. Each command is acked on
+    // receipt and duplicates (same sequence_id from the same peer) are not
+    // run again; each response is retransmitted until the peer acks it,
+    // after a timeout derived from the measured round trip.
+    constexpr int UDP_COMMAND_RTO_INITIAL_MS = 250;   // Before the first RTT sample
+    constexpr int UDP_COMMAND_RTO_MIN_MS = 40;
+    constexpr int UDP_COMMAND_RTO_MAX_MS = 2000;
+    constexpr int UDP_COMMAND_MAX_TRANSMISSIONS = 8;  // Then the response is given up
+    constexpr int UDP_COMMAND_DEDUPE_SEC = 30;        // How long a sequence_id is remembered
+    constexpr int UDP_COMMAND_MAX_PEERS = 8;
+
+    // DPM_UDP_COMMAND_PORT overrides the port; 0 turns the channel off
+    inline int getUdpCommandPort() {
+        const char* env_port = std::getenv("DPM_UDP_COMMAND_PORT");
+        if (env_port != nullptr) {
+            return std::atoi(env_port);
+        }
+        return UDP_COMMAND_PORT;
+    }
+
+    // Hot upgrade: a running instance listens here, and a new build started
+    // with --upgrade connects and is handed the listening and UDP sockets
+    // (SCM_RIGHTS) instead of binding them, so clients never see a refused
+    // connection. The old instance releases the camera for the new one and
+    // keeps serving until the new one reports ready, then exits. If the new
+    // one dies first, the old one reconnects the camera and carries on.
+    // Set DPM_HANDOFF_SOCKET to override the path, or to "" to disable it.
+    constexpr const char* HANDOFF_SOCKET_PATH = "/run/dpm/handoff.sock";
+    constexpr int HANDOFF_SOCKETS_TIMEOUT_SEC = 30;   // New instance waiting for the sockets
+    constexpr int HANDOFF_READY_TIMEOUT_SEC = 120;    // Old instance waiting for "ready"
+
+    inline std::string getHandoffSocketPath() {
+        const char* env_path = std::getenv("DPM_HANDOFF_SOCKET");
+        if (env_path != nullptr) {
+            return std::string(env_path);
+        }
+        return HANDOFF_SOCKET_PATH;
+    }
+
+    // Largest command frame accepted on the TCP channel. Longer lines are
+    // discarded (and counted) without being buffered.
+    constexpr int TCP_MAX_FRAME_SIZE = 16384;
+
+    // Command execution
+    constexpr int COMMAND_WORKER_THREADS = 4;    // Worker pool shared by all clients
+    constexpr int TCP_MAX_IN_FLIGHT = 8;         // Per-connection cap; reading pauses at the cap
+    constexpr int COMMAND_COALESCE_WINDOW_MS = 100;  // set_property waits this long for a newer value
+                                                     // of the same property (unless work is queued)
+
+    // Outbound queue per client. Above the high-water mark no further commands
+    // are read from that client; past the limit notifications are dropped and
+    // a client that is not reading its responses is disconnected.
+    constexpr size_t TCP_OUTBOUND_HIGH_WATER = 64 * 1024;
+    constexpr size_t TCP_MAX_OUTBOUND_BYTES = 256 * 1024;
+
+    // Streamed responses (a command sent with "stream": true, for commands
+    // that support it). The result goes out in chunks of about
+    // STREAM_CHUNK_BYTES and the worker producing it waits while the client
+    // has more than STREAM_WINDOW_BYTES unsent, so a large result is never
+    // held whole. A client that reads nothing for STREAM_STALL_TIMEOUT_MS
+    // gets the stream cut short with an error.
+    constexpr size_t STREAM_CHUNK_BYTES = 16 * 1024;
+    constexpr size_t STREAM_WINDOW_BYTES = 64 * 1024;
+    constexpr int STREAM_STALL_TIMEOUT_MS = 10000;
+
+    // Rate limits per client and command class (token buckets). Camera
+    // commands share one camera, so they get the tighter budget. A coalesced
+    // command (set_property) gets its token back if it is superseded - it
+    // never reached the camera - and a batch costs one token per item. Over
+    // the limit a command is answered with RATE_LIMITED and when to retry.
+    constexpr double RATE_LIMIT_CAMERA_PER_SEC = 20.0;
+    constexpr int RATE_LIMIT_CAMERA_BURST = 10;
+    constexpr double RATE_LIMIT_GENERAL_PER_SEC = 50.0;
+    constexpr int RATE_LIMIT_GENERAL_BURST = 25;
+
+    // Successful responses kept for retries: a command resent in the same
+    // session (handshake client_id, resumed on a new connection) with the
+    // same sequence_id gets the original response instead of running again
+    constexpr size_t RESPONSE_CACHE_MAX_ENTRIES = 512;
+    constexpr size_t RESPONSE_CACHE_MAX_BYTES = 512 * 1024;
+    constexpr int RESPONSE_CACHE_MAX_AGE_SEC = 120;
+
+    // Sessions, by the client_id from the handshake. Notifications and
+    // property events a client misses while disconnected are replayed when
+    // it reconnects and resumes (handshake resume_from).
+    constexpr size_t SESSION_BACKLOG_SIZE = 64;  // Messages kept per session
+    constexpr int SESSION_TTL_SEC = 600;         // A detached session is forgotten after this
+    constexpr size_t MAX_SESSIONS = 16;
+
+    // Command batches
+    constexpr int MAX_BATCH_COMMANDS = 32;
+
+    // Camera access. Commands queue for the camera by priority (capture,
+    // then property writes, then background refresh) and fail "busy" only
+    // after waiting this long.
+    constexpr int CAMERA_ACCESS_TIMEOUT_MS = 2000;
 }
 
 #endif // CONFIG_H
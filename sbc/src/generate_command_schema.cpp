@@ -0,0 +1,496 @@
+// generate_command_schema.cpp - Build step: C++ parameter schema from protocol/commands.json
+//
+// Writes protocol/command_schema.h, which holds for every command in the spec:
+//   - a typed parameter struct (<Command>Params) with a field per parameter
+//   - constexpr checks for enumerated values and numeric ranges
+//   - validate(), which checks payload.parameters before the command is queued
+//   - from(), which reads validated parameters into the struct
+// and a constexpr table (schema::COMMANDS) of each command's implementation
+// status, so code can check at compile time that what it registers is in the
+// spec. Run by CMake whenever commands.json changes.
+//
+// Usage: generate_command_schema <commands.json> <output header>
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using ordered_json = nlohmann::ordered_json;
+
+namespace {
+
+struct Param {
+    std::string name;
+    std::string type;                // string, integer, number, boolean, array, object, any
+    std::string items;               // Element type of an array ("" = unchecked)
+    bool required = false;
+    std::vector<std::string> values; // Enumerated strings (array: per item)
+    bool has_minimum = false;
+    bool has_maximum = false;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    ordered_json default_value;      // null if none
+};
+
+struct Command {
+    std::string name;
+    std::string type_name;           // e.g. CameraFocusParams
+    std::vector<Param> params;
+    bool air_side = false;
+    bool ground_side = false;
+    std::string version;
+};
+
+// "camera.auto_focus_hold" -> "CameraAutoFocusHold"
+std::string pascalCase(const std::string& name) {
+    std::string result;
+    bool upper = true;
+    for (char c : name) {
+        if (c == '.' || c == '_' || c == '-') {
+            upper = true;
+            continue;
+        }
+        result += upper ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : c;
+        upper = false;
+    }
+    return result;
+}
+
+std::string upperCase(const std::string& name) {
+    std::string result;
+    for (char c : name) {
+        result += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return result;
+}
+
+bool isIdentifier(const std::string& name) {
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+        return false;
+    }
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// C++ string literal (JSON escaping is valid C++ for the ASCII the spec uses)
+std::string literal(const std::string& value) {
+    return ordered_json(value).dump();
+}
+
+std::string number(double value) {
+    if (value == static_cast<double>(static_cast<long long>(value))) {
+        return std::to_string(static_cast<long long>(value));
+    }
+    return ordered_json(value).dump();
+}
+
+std::string joined(const std::vector<std::string>& values) {
+    std::string result;
+    for (const auto& v : values) {
+        result += (result.empty() ? "" : ", ") + v;
+    }
+    return result;
+}
+
+std::string memberType(const Param& p) {
+    if (p.type == "string")  return "std::string";
+    if (p.type == "integer") return "int64_t";
+    if (p.type == "number")  return "double";
+    if (p.type == "boolean") return "bool";
+    if (p.type == "array" && p.items == "string") return "std::vector<std::string>";
+    return "nlohmann::json";  // object, any, arrays of anything else
+}
+
+std::string typeCheck(const std::string& type, const std::string& value) {
+    if (type == "string")  return value + ".is_string()";
+    if (type == "integer") return value + ".is_number_integer()";
+    if (type == "number")  return value + ".is_number()";
+    if (type == "boolean") return value + ".is_boolean()";
+    if (type == "array")   return value + ".is_array()";
+    if (type == "object")  return value + ".is_object()";
+    return "";
+}
+
+Command readCommand(const std::string& name, const ordered_json& spec) {
+    Command command;
+    command.name = name;
+    command.type_name = pascalCase(name) + "Params";
+
+    if (spec.contains("implemented")) {
+        const ordered_json& implemented = spec["implemented"];
+        command.air_side = implemented.value("air_side", false);
+        command.ground_side = implemented.value("ground_side", false);
+        command.version = implemented.value("version", "");
+    }
+
+    if (!spec.contains("parameters")) {
+        return command;
+    }
+
+    for (const auto& entry : spec["parameters"].items()) {
+        const ordered_json& p = entry.value();
+        Param param;
+        param.name = entry.key();
+        if (!isIdentifier(param.name)) {
+            throw std::runtime_error(name + ": parameter '" + param.name + "' is not a valid identifier");
+        }
+
+        param.type = p.value("type", "any");
+        param.items = p.value("items", "");
+        param.required = p.value("required", false);
+        if (p.contains("enum")) {
+            for (const auto& v : p["enum"]) {
+                param.values.push_back(v.get<std::string>());
+            }
+        }
+        if (p.contains("minimum")) {
+            param.has_minimum = true;
+            param.minimum = p["minimum"].get<double>();
+        }
+        if (p.contains("maximum")) {
+            param.has_maximum = true;
+            param.maximum = p["maximum"].get<double>();
+        }
+        if (p.contains("default")) {
+            param.default_value = p["default"];
+        }
+
+        if (!param.values.empty() && param.type != "string" &&
+            !(param.type == "array" && param.items == "string")) {
+            throw std::runtime_error(name + ": enum on '" + param.name + "' needs type string or array of string");
+        }
+        command.params.push_back(param);
+    }
+    return command;
+}
+
+// Declaration of one command's struct
+void writeStruct(std::ostream& out, const Command& command) {
+    out << "// " << command.name << "\n";
+    out << "struct " << command.type_name << " {\n";
+    out << "    static constexpr std::string_view COMMAND = " << literal(command.name) << ";\n";
+
+    if (!command.params.empty()) {
+        out << "\n";
+    }
+    for (const auto& p : command.params) {
+        out << "    " << memberType(p) << " " << p.name;
+        if (!p.default_value.is_null() && memberType(p) != "nlohmann::json") {
+            out << " = " << (p.default_value.is_string() ? literal(p.default_value.get<std::string>())
+                                                         : p.default_value.dump());
+        } else if (p.type == "integer" || p.type == "number") {
+            out << " = 0";
+        } else if (p.type == "boolean") {
+            out << " = false";
+        }
+        out << ";\n";
+        if (!p.required) {
+            out << "    bool has_" << p.name << " = false;\n";
+        }
+    }
+
+    bool any_checks = false;
+    for (const auto& p : command.params) {
+        if (!p.values.empty()) {
+            if (!any_checks) {
+                out << "\n";
+                any_checks = true;
+            }
+            out << "    static constexpr std::string_view " << upperCase(p.name) << "_VALUES[] = {";
+            for (size_t i = 0; i < p.values.size(); ++i) {
+                out << (i ? ", " : "") << literal(p.values[i]);
+            }
+            out << "};\n";
+            out << "    static constexpr bool valid" << pascalCase(p.name) << "(std::string_view value) {\n";
+            out << "        return detail::oneOf(value, " << upperCase(p.name) << "_VALUES);\n";
+            out << "    }\n";
+        }
+        if ((p.has_minimum || p.has_maximum) && (p.type == "integer" || p.type == "number")) {
+            if (!any_checks) {
+                out << "\n";
+                any_checks = true;
+            }
+            std::string arg = p.type == "integer" ? "int64_t" : "double";
+            std::string condition;
+            if (p.has_minimum) {
+                condition = "value >= " + number(p.minimum);
+            }
+            if (p.has_maximum) {
+                condition += (condition.empty() ? "" : " && ") + std::string("value <= ") + number(p.maximum);
+            }
+            out << "    static constexpr bool valid" << pascalCase(p.name) << "(" << arg << " value) {\n";
+            out << "        return " << condition << ";\n";
+            out << "    }\n";
+        }
+    }
+
+    out << "\n";
+    out << "    static bool validate(const nlohmann::json& payload, messages::ErrorCode& error_code, std::string& error);\n";
+    out << "    static " << command.type_name << " from(const nlohmann::json& payload);\n";
+    out << "};\n\n";
+}
+
+// Checks for one parameter inside validate()
+void writeParamCheck(std::ostream& out, const Param& p) {
+    std::ostringstream checks;
+    std::string check = typeCheck(p.type, "value");
+    if (!check.empty()) {
+        checks << "        if (!" << check << ") {\n";
+        checks << "            return detail::fail(error_code, error, messages::ErrorCode::INVALID_PARAMETER,\n";
+        checks << "                                \"Parameter '" << p.name << "' must be of type " << p.type << "\");\n";
+        checks << "        }\n";
+    }
+
+    std::string valid = "valid" + pascalCase(p.name);
+    std::string valid_list = literal(" (valid: " + joined(p.values) + ")");
+    if (!p.values.empty() && p.type == "string") {
+        checks << "        if (!" << valid << "(value.get_ref<const std::string&>())) {\n";
+        checks << "            return detail::fail(error_code, error, messages::ErrorCode::INVALID_PARAMETER,\n";
+        checks << "                                \"Invalid " << p.name << " value: \" + value.get<std::string>() +\n";
+        checks << "                                " << valid_list << ");\n";
+        checks << "        }\n";
+    }
+
+    if (p.type == "array" && !p.items.empty()) {
+        std::string item_check = typeCheck(p.items, "item");
+        checks << "        for (const auto& item : value) {\n";
+        if (!item_check.empty()) {
+            checks << "            if (!" << item_check << ") {\n";
+            checks << "                return detail::fail(error_code, error, messages::ErrorCode::INVALID_PARAMETER,\n";
+            checks << "                                    \"Parameter '" << p.name << "' items must be of type " << p.items << "\");\n";
+            checks << "            }\n";
+        }
+        if (!p.values.empty()) {
+            checks << "            if (!" << valid << "(item.get_ref<const std::string&>())) {\n";
+            checks << "                return detail::fail(error_code, error, messages::ErrorCode::INVALID_PARAMETER,\n";
+            checks << "                                    \"Invalid " << p.name << " value: \" + item.get<std::string>() +\n";
+            checks << "                                    " << valid_list << ");\n";
+            checks << "            }\n";
+        }
+        checks << "        }\n";
+    }
+
+    if ((p.has_minimum || p.has_maximum) && (p.type == "integer" || p.type == "number")) {
+        std::string range = literal(" (valid: " + (p.has_minimum ? number(p.minimum) : std::string("-inf")) + "-" +
+                                    (p.has_maximum ? number(p.maximum) : std::string("inf")) + ")");
+        std::string read = p.type == "integer" ? "detail::toInt64(value)" : "value.get<double>()";
+        checks << "        if (!" << valid << "(" << read << ")) {\n";
+        checks << "            return detail::fail(error_code, error, messages::ErrorCode::INVALID_PARAMETER,\n";
+        checks << "                                \"Invalid " << p.name << " value: \" + value.dump() + " << range << ");\n";
+        checks << "        }\n";
+    }
+
+    std::string missing = "        return detail::fail(error_code, error, messages::ErrorCode::MISSING_REQUIRED_FIELD,\n"
+                          "                            \"Missing required field: " + p.name + "\");\n";
+
+    // "any" with nothing to check beyond presence
+    if (checks.str().empty()) {
+        if (p.required) {
+            out << "    if (!parameters->contains(" << literal(p.name) << ")) {\n";
+            out << missing;
+            out << "    }\n";
+        }
+        return;
+    }
+
+    out << "    if (auto it = parameters->find(" << literal(p.name) << "); it != parameters->end()) {\n";
+    out << "        const nlohmann::json& value = *it;\n";
+    out << checks.str();
+    if (p.required) {
+        out << "    } else {\n";
+        out << missing;
+    }
+    out << "    }\n";
+}
+
+// Out-of-class validate() and from() for one command
+void writeFunctions(std::ostream& out, const Command& command) {
+    bool any_required = false;
+    for (const auto& p : command.params) {
+        any_required = any_required || p.required;
+    }
+
+    std::string prefix = "inline bool " + command.type_name + "::validate(";
+    out << prefix << "const nlohmann::json& payload,\n";
+    out << std::string(prefix.size(), ' ') << "messages::ErrorCode& error_code, std::string& error) {\n";
+    if (command.params.empty()) {
+        out << "    (void)payload;\n";
+        out << "    (void)error_code;\n";
+        out << "    (void)error;\n";
+        out << "    return true;\n";
+    } else {
+        out << "    auto parameters = payload.find(\"parameters\");\n";
+        out << "    if (parameters == payload.end() || !parameters->is_object()) {\n";
+        if (any_required) {
+            out << "        return detail::fail(error_code, error, messages::ErrorCode::MISSING_REQUIRED_FIELD,\n";
+            out << "                            \"Missing required 'parameters' object\");\n";
+        } else {
+            out << "        return true;\n";
+        }
+        out << "    }\n\n";
+        for (const auto& p : command.params) {
+            writeParamCheck(out, p);
+        }
+        out << "    return true;\n";
+    }
+    out << "}\n\n";
+
+    out << "inline " << command.type_name << " " << command.type_name << "::from(const nlohmann::json& payload) {\n";
+    out << "    " << command.type_name << " result;\n";
+    if (command.params.empty()) {
+        out << "    (void)payload;\n";
+    } else {
+        out << "    auto parameters = payload.find(\"parameters\");\n";
+        out << "    if (parameters == payload.end() || !parameters->is_object()) {\n";
+        out << "        return result;\n";
+        out << "    }\n";
+        for (const auto& p : command.params) {
+            std::string type = memberType(p);
+            std::string read = type == "nlohmann::json" ? "*it" : "it->get<" + type + ">()";
+            out << "    if (auto it = parameters->find(" << literal(p.name) << "); it != parameters->end()) {\n";
+            out << "        result." << p.name << " = " << read << ";\n";
+            if (!p.required) {
+                out << "        result.has_" << p.name << " = true;\n";
+            }
+            out << "    }\n";
+        }
+    }
+    out << "    return result;\n";
+    out << "}\n\n";
+}
+
+std::string generate(const std::vector<Command>& commands, const std::string& source) {
+    std::ostringstream out;
+    out << "// Generated by generate_command_schema from " << source << " - do not edit\n";
+    out << "#ifndef COMMAND_SCHEMA_H\n";
+    out << "#define COMMAND_SCHEMA_H\n\n";
+    out << "#include <cstdint>\n";
+    out << "#include <limits>\n";
+    out << "#include <string>\n";
+    out << "#include <string_view>\n";
+    out << "#include <vector>\n";
+    out << "#include <nlohmann/json.hpp>\n";
+    out << "#include \"protocol/messages.h\"\n\n";
+    out << "namespace schema {\n\n";
+
+    out << "namespace detail {\n\n";
+    out << "template <size_t N>\n";
+    out << "constexpr bool oneOf(std::string_view value, const std::string_view (&values)[N]) {\n";
+    out << "    for (const auto& v : values) {\n";
+    out << "        if (v == value) {\n";
+    out << "            return true;\n";
+    out << "        }\n";
+    out << "    }\n";
+    out << "    return false;\n";
+    out << "}\n\n";
+    out << "inline bool fail(messages::ErrorCode& error_code, std::string& error,\n";
+    out << "                 messages::ErrorCode code, std::string message) {\n";
+    out << "    error_code = code;\n";
+    out << "    error = std::move(message);\n";
+    out << "    return false;\n";
+    out << "}\n\n";
+    out << "// Unsigned values past int64_t saturate, so range checks still reject them\n";
+    out << "inline int64_t toInt64(const nlohmann::json& value) {\n";
+    out << "    if (value.is_number_unsigned() &&\n";
+    out << "        value.get<uint64_t>() > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {\n";
+    out << "        return std::numeric_limits<int64_t>::max();\n";
+    out << "    }\n";
+    out << "    return value.get<int64_t>();\n";
+    out << "}\n\n";
+    out << "} // namespace detail\n\n";
+
+    for (const auto& command : commands) {
+        writeStruct(out, command);
+    }
+    for (const auto& command : commands) {
+        writeFunctions(out, command);
+    }
+
+    out << "using ParamValidator = bool (*)(const nlohmann::json& payload, messages::ErrorCode& error_code,\n";
+    out << "                                std::string& error);\n\n";
+    out << "// Every command in the spec and where it is implemented\n";
+    out << "struct CommandInfo {\n";
+    out << "    std::string_view name;\n";
+    out << "    bool air_side;\n";
+    out << "    bool ground_side;\n";
+    out << "    std::string_view version;  // Protocol version that introduced it\n";
+    out << "    ParamValidator validate;\n";
+    out << "};\n\n";
+    out << "inline constexpr CommandInfo COMMANDS[] = {\n";
+    for (const auto& command : commands) {
+        out << "    {" << literal(command.name) << ", " << (command.air_side ? "true" : "false") << ", "
+            << (command.ground_side ? "true" : "false") << ", " << literal(command.version) << ", &"
+            << command.type_name << "::validate},\n";
+    }
+    out << "};\n\n";
+    out << "// nullptr if the command is not in the spec\n";
+    out << "constexpr const CommandInfo* findCommand(std::string_view name) {\n";
+    out << "    for (const auto& command : COMMANDS) {\n";
+    out << "        if (command.name == name) {\n";
+    out << "            return &command;\n";
+    out << "        }\n";
+    out << "    }\n";
+    out << "    return nullptr;\n";
+    out << "}\n\n";
+    out << "// In the spec and marked implemented on the air side\n";
+    out << "constexpr bool isImplemented(std::string_view name) {\n";
+    out << "    const CommandInfo* command = findCommand(name);\n";
+    out << "    return command != nullptr && command->air_side;\n";
+    out << "}\n\n";
+    out << "} // namespace schema\n\n";
+    out << "#endif // COMMAND_SCHEMA_H\n";
+    return out.str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <commands.json> <output header>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::string header;
+    size_t command_count = 0;
+    try {
+        ordered_json spec;
+        file >> spec;
+
+        std::vector<Command> commands;
+        for (const auto& entry : spec["commands"].items()) {
+            commands.push_back(readCommand(entry.key(), entry.value()));
+        }
+        command_count = commands.size();
+
+        std::string source = argv[1];
+        size_t slash = source.find_last_of('/');
+        header = generate(commands, slash == std::string::npos ? source : source.substr(slash + 1));
+    } catch (const std::exception& e) {
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::ofstream output(argv[2]);
+    if (!output.is_open()) {
+        std::cerr << "Failed to write " << argv[2] << std::endl;
+        return 1;
+    }
+    output << header;
+    std::cout << "Generated " << argv[2] << " (" << command_count << " commands)" << std::endl;
+    return 0;
+}
@@ -4,11 +4,16 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <mutex>
 #include "config.h"
 #include "utils/logger.h"
 #include "protocol/tcp_server.h"
 #include "protocol/udp_broadcaster.h"
 #include "protocol/heartbeat.h"
+#include "protocol/udp_command_channel.h"
+#include "protocol/socket_handoff.h"
+#include "protocol/camera_commands.h"
+#include "protocol/batch_command.h"
 #include "camera/camera_interface.h"
 #include "camera/property_loader.h"
 
@@ -16,10 +21,13 @@
 std::unique_ptr<TCPServer> g_tcp_server;
 std::unique_ptr<UDPBroadcaster> g_udp_broadcaster;
 std::unique_ptr<Heartbeat> g_heartbeat;
+std::unique_ptr<UDPCommandChannel> g_udp_commands;
+std::unique_ptr<SocketHandoff> g_handoff;
 std::shared_ptr<CameraInterface> g_camera;
 std::atomic<bool> g_shutdown_requested(false);
 std::atomic<bool> g_health_check_running(false);
 std::thread g_health_check_thread;
+std::mutex g_health_check_mutex;  // Start/stop from main and handoff threads
 
 // Factory function from camera_sony.cpp
 extern "C" CameraInterface* createCamera();
@@ -118,6 +126,23 @@ void cameraHealthCheckThread() {
     Logger::info("Camera health check thread stopped");
 }
 
+void startCameraHealthCheck() {
+    std::lock_guard<std::mutex> lock(g_health_check_mutex);
+    if (g_health_check_running) {
+        return;
+    }
+    g_health_check_running = true;
+    g_health_check_thread = std::thread(cameraHealthCheckThread);
+}
+
+void stopCameraHealthCheck() {
+    std::lock_guard<std::mutex> lock(g_health_check_mutex);
+    g_health_check_running = false;
+    if (g_health_check_thread.joinable()) {
+        g_health_check_thread.join();
+    }
+}
+
 int main(int argc, char* argv[]) {
     // Check for --version flag
     if (argc > 1 && std::string(argv[1]) == "--version") {
@@ -125,6 +150,14 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    // --upgrade: take over the sockets of the running instance
+    bool upgrade = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--upgrade") {
+            upgrade = true;
+        }
+    }
+
     // Print banner
     printBanner();
 
@@ -157,6 +190,20 @@ int main(int argc, char* argv[]) {
                     ", Shutter=" + std::to_string(PropertyLoader::getValueCount("shutter_speed")) +
                     ", Aperture=" + std::to_string(PropertyLoader::getValueCount("aperture")));
 
+        // Hot upgrade: the old instance releases the camera before it hands
+        // over its sockets, so this comes before our camera connect
+        std::string handoff_path = config::getHandoffSocketPath();
+        if (!handoff_path.empty()) {
+            g_handoff = std::make_unique<SocketHandoff>(handoff_path);
+        }
+        if (upgrade) {
+            if (!g_handoff) {
+                Logger::warning("--upgrade ignored - hot upgrade is disabled (DPM_HANDOFF_SOCKET is empty)");
+            } else if (!g_handoff->takeOver()) {
+                Logger::warning("Hot upgrade failed - starting normally");
+            }
+        }
+
         // Create camera interface (Sony SDK integration)
         Logger::info("Creating camera interface (Sony SDK)...");
         g_camera = std::shared_ptr<CameraInterface>(createCamera());
@@ -177,7 +224,8 @@ int main(int argc, char* argv[]) {
         // Create TCP server
         Logger::info("Creating TCP server on port " + std::to_string(config::TCP_PORT) + "...");
         g_tcp_server = std::make_unique<TCPServer>(config::TCP_PORT);
-        g_tcp_server->setCamera(g_camera);
+        registerCameraCommands(g_tcp_server->commands(), g_camera, *g_tcp_server);
+        registerBatchCommand(g_tcp_server->commands(), g_camera);
 
         // Create UDP broadcaster
         std::string ground_ip = config::getGroundStationIP();
@@ -187,6 +235,7 @@ int main(int argc, char* argv[]) {
             ground_ip.c_str()
         );
         g_udp_broadcaster->setCamera(g_camera);
+        g_tcp_server->addMetricsSource("udp_status", [] { return g_udp_broadcaster->stats(); });
 
         // Create heartbeat handler
         Logger::info("Creating heartbeat handler (port " + std::to_string(config::UDP_HEARTBEAT_PORT) + ")...");
@@ -194,30 +243,88 @@ int main(int argc, char* argv[]) {
             config::UDP_HEARTBEAT_PORT,
             ground_ip.c_str()
         );
+        g_udp_broadcaster->setHeartbeat(g_heartbeat.get());  // Link health sets the status rate
 
         // Connect TCP server to broadcasters for dynamic IP discovery
         g_tcp_server->setUDPBroadcaster(g_udp_broadcaster.get());
         g_tcp_server->setHeartbeat(g_heartbeat.get());
         Logger::info("Dynamic IP discovery enabled - broadcasters will auto-update when client connects");
 
+        // Co-located processes (flight-controller bridge, mission scripts) connect locally
+        g_tcp_server->setLocalSocketPath(config::getLocalSocketPath());
+
+        // Optional UDP command transport for lossy radio links
+        int udp_command_port = config::getUdpCommandPort();
+        if (udp_command_port > 0) {
+            g_udp_commands = std::make_unique<UDPCommandChannel>(udp_command_port, *g_tcp_server);
+            g_tcp_server->addMetricsSource("udp_commands", [] { return g_udp_commands->stats(); });
+        }
+
+        // Serve on the sockets of the instance we are replacing
+        if (g_handoff && g_handoff->tookOver()) {
+            g_tcp_server->inheritSockets(g_handoff->take("tcp"), g_handoff->take("local"));
+            if (g_udp_commands) {
+                g_udp_commands->inheritSocket(g_handoff->take("udp_commands"));
+            }
+            g_heartbeat->inheritSocket(g_handoff->take("heartbeat"));
+        }
+
         // Start all components
         Logger::info("========================================");
         Logger::info("Starting all components...");
         Logger::info("========================================");
 
         g_tcp_server->start();
+        if (g_udp_commands) {
+            g_udp_commands->start();
+        }
         g_udp_broadcaster->start();
         g_heartbeat->start();
 
         // Start camera health check thread
-        g_health_check_running = true;
-        g_health_check_thread = std::thread(cameraHealthCheckThread);
+        startCameraHealthCheck();
+
+        if (g_handoff) {
+            // Serving now - the instance we replaced (if any) can go
+            g_handoff->ready();
+
+            g_handoff->offer("tcp", g_tcp_server->listeningSocket());
+            g_handoff->offer("local", g_tcp_server->localListeningSocket());
+            if (g_udp_commands) {
+                g_handoff->offer("udp_commands", g_udp_commands->socketFd());
+            }
+            g_handoff->offer("heartbeat", g_heartbeat->socketFd());
+            g_handoff->start(
+                [] {
+                    // Only one process can hold the camera
+                    Logger::info("Releasing camera for the replacement instance...");
+                    stopCameraHealthCheck();
+                    g_camera->disconnect();
+                },
+                [] {
+                    g_tcp_server->handOffListeners();
+                    g_shutdown_requested = true;
+                },
+                [] {
+                    if (g_shutdown_requested) {
+                        return;
+                    }
+                    Logger::info("Reclaiming camera...");
+                    if (!g_camera->connect()) {
+                        Logger::warning("Camera reconnect failed - will retry automatically");
+                    }
+                    startCameraHealthCheck();
+                });
+        }
 
         Logger::info("========================================");
         Logger::info("Payload Manager Service Running");
         Logger::info("========================================");
         Logger::info("TCP Command Server: 0.0.0.0:" + std::to_string(config::TCP_PORT));
-        Logger::info("UDP Status Broadcast: " + ground_ip + ":" + std::to_string(config::UDP_STATUS_PORT) + " (5 Hz)");
+        if (g_udp_commands && g_udp_commands->isRunning()) {
+            Logger::info("UDP Command Channel: 0.0.0.0:" + std::to_string(udp_command_port));
+        }
+        Logger::info("UDP Status Broadcast: " + ground_ip + ":" + std::to_string(config::UDP_STATUS_PORT) + " (1-10 Hz, adaptive)");
         Logger::info("Heartbeat: " + ground_ip + ":" + std::to_string(config::UDP_HEARTBEAT_PORT) + " (1 Hz)");
         Logger::info(std::string("Camera: Sony SDK ") + (camera_connected ? "(connected)" : "(not connected)"));
         Logger::info("========================================");
@@ -226,7 +333,7 @@ int main(int argc, char* argv[]) {
 
         std::cout << "\nService started successfully!\n";
         std::cout << "TCP server: port " << config::TCP_PORT << "\n";
-        std::cout << "UDP status: " << ground_ip << ":" << config::UDP_STATUS_PORT << " (5 Hz)\n";
+        std::cout << "UDP status: " << ground_ip << ":" << config::UDP_STATUS_PORT << " (1-10 Hz, adaptive)\n";
         std::cout << "Heartbeat: " << ground_ip << ":" << config::UDP_HEARTBEAT_PORT << " (1 Hz)\n";
         std::cout << "\nPress Ctrl+C to stop...\n\n";
 
@@ -256,14 +363,16 @@ int main(int argc, char* argv[]) {
 
         std::cout << "\nShutting down...\n";
 
+        // No handoff may start (or reclaim the camera) from here on
+        if (g_handoff) {
+            g_handoff->stop();
+        }
+
         // Stop health check thread first
         if (g_health_check_running) {
             Logger::info("Stopping camera health check...");
-            g_health_check_running = false;
-            if (g_health_check_thread.joinable()) {
-                g_health_check_thread.join();
-            }
         }
+        stopCameraHealthCheck();
 
         if (g_heartbeat) {
             Logger::info("Stopping heartbeat handler...");
@@ -275,6 +384,12 @@ int main(int argc, char* argv[]) {
             g_udp_broadcaster->stop();
         }
 
+        // Before the TCP server - its workers answer UDP commands
+        if (g_udp_commands) {
+            Logger::info("Stopping UDP command channel...");
+            g_udp_commands->stop();
+        }
+
         if (g_tcp_server) {
             Logger::info("Stopping TCP server...");
             g_tcp_server->stop();
@@ -300,14 +415,11 @@ int main(int argc, char* argv[]) {
         std::cerr << "FATAL ERROR: " << e.what() << std::endl;
 
         // Cleanup on error
-        if (g_health_check_running) {
-            g_health_check_running = false;
-            if (g_health_check_thread.joinable()) {
-                g_health_check_thread.join();
-            }
-        }
+        if (g_handoff) g_handoff->stop();
+        stopCameraHealthCheck();
         if (g_heartbeat) g_heartbeat->stop();
         if (g_udp_broadcaster) g_udp_broadcaster->stop();
+        if (g_udp_commands) g_udp_commands->stop();
         if (g_tcp_server) g_tcp_server->stop();
         if (g_camera) g_camera->disconnect();
 
@@ -0,0 +1,166 @@
+#include "protocol/batch_command.h"
+#include "protocol/command_registry.h"
+#include "protocol/command_schema.h"
+#include "protocol/messages.h"
+#include "camera/camera_interface.h"
+#include "config.h"
+#include "utils/logger.h"
+#include <mutex>
+
+namespace {
+
+static_assert(schema::isImplemented("batch"), "batch missing from commands.json");
+
+// Check every item before anything runs, so a malformed batch never
+// touches the camera. Returns false with error_code/error describing the
+// first bad item.
+bool validateItems(const CommandRegistry& registry, const json& items,
+                   std::vector<const CommandSpec*>& specs, bool& needs_camera,
+                   messages::ErrorCode& error_code, std::string& error) {
+    if (items.empty()) {
+        error_code = messages::ErrorCode::INVALID_PARAMETER;
+        error = "Batch contains no commands";
+        return false;
+    }
+
+    if (items.size() > static_cast<size_t>(config::MAX_BATCH_COMMANDS)) {
+        error_code = messages::ErrorCode::INVALID_PARAMETER;
+        error = "Batch contains " + std::to_string(items.size()) + " commands (maximum " +
+                std::to_string(config::MAX_BATCH_COMMANDS) + ")";
+        return false;
+    }
+
+    needs_camera = false;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const json& item = items[i];
+        std::string where = "commands[" + std::to_string(i) + "]";
+
+        if (!item.is_object() || !item.contains("command") || !item["command"].is_string()) {
+            error_code = messages::ErrorCode::MISSING_REQUIRED_FIELD;
+            error = where + ": missing command";
+            return false;
+        }
+
+        std::string name = item["command"].get<std::string>();
+        if (name == "batch" || name == "handshake") {
+            error_code = messages::ErrorCode::INVALID_PARAMETER;
+            error = where + ": " + name + " cannot be batched";
+            return false;
+        }
+
+        const CommandSpec* spec = registry.find(name);
+        if (!spec) {
+            error_code = messages::ErrorCode::UNKNOWN_COMMAND;
+            error = where + ": unknown command " + name;
+            return false;
+        }
+
+        if (!registry.validateParameters(*spec, item, error_code, error)) {
+            error = where + " (" + name + "): " + error;
+            return false;
+        }
+
+        needs_camera = needs_camera || spec->has(FLAG_CAMERA_EXCLUSIVE);
+        specs.push_back(spec);
+    }
+
+    return true;
+}
+
+json handleBatch(const CommandRegistry& registry, const std::shared_ptr<CameraInterface>& camera,
+                 const json& payload, int seq_id) {
+    const json& params = payload["parameters"];
+    const json& items = params["commands"];
+    bool stop_on_failure = params.value("on_failure", "stop") == "stop";
+
+    std::vector<const CommandSpec*> specs;
+    bool needs_camera = false;
+    messages::ErrorCode error_code = messages::ErrorCode::INVALID_PARAMETER;
+    std::string error;
+    if (!validateItems(registry, items, specs, needs_camera, error_code, error)) {
+        return messages::createErrorResponse(seq_id, "batch", error_code, error);
+    }
+
+    // One acquisition for every camera item. The items' own locks re-enter
+    // it, and nothing else reaches the SDK until the batch is done.
+    std::unique_lock<CameraAccess> camera_hold;
+    if (needs_camera && camera) {
+        camera_hold = std::unique_lock<CameraAccess>(camera->access(), std::defer_lock);
+        if (!camera_hold.try_lock_for(std::chrono::milliseconds(config::CAMERA_ACCESS_TIMEOUT_MS))) {
+            return messages::createErrorResponse(
+                seq_id, "batch",
+                messages::ErrorCode::COMMAND_FAILED,
+                "Camera busy - batch not started"
+            );
+        }
+    }
+
+    Logger::info("Executing batch of " + std::to_string(specs.size()) + " commands" +
+                 (needs_camera ? " (camera held)" : ""));
+
+    json results = json::array();
+    int succeeded = 0;
+    int failed = 0;
+
+    for (size_t i = 0; i < specs.size(); ++i) {
+        const CommandSpec& spec = *specs[i];
+        json entry = {{"index", i}, {"command", spec.name}};
+
+        if (failed > 0 && stop_on_failure) {
+            entry["status"] = "skipped";
+            results.push_back(entry);
+            continue;
+        }
+
+        json response;
+        try {
+            response = spec.handler(items[i], seq_id);
+        } catch (const std::exception& e) {
+            Logger::error("Exception in batched " + spec.name + ": " + std::string(e.what()));
+            response = messages::createErrorResponse(
+                seq_id, spec.name, messages::ErrorCode::INTERNAL_ERROR, std::string(e.what())
+            );
+        }
+
+        // Keep the item's own status/result/error, drop the envelope
+        const json& item_payload = response["payload"];
+        entry["status"] = item_payload.value("status", "error");
+        if (item_payload.contains("result")) {
+            entry["result"] = item_payload["result"];
+        }
+        if (item_payload.contains("error")) {
+            entry["error"] = item_payload["error"];
+        }
+
+        if (entry["status"] == "success") {
+            ++succeeded;
+        } else {
+            ++failed;
+        }
+        results.push_back(entry);
+    }
+
+    json result = {
+        {"results", results},
+        {"succeeded", succeeded},
+        {"failed", failed},
+        {"skipped", static_cast<int>(specs.size()) - succeeded - failed}
+    };
+
+    return messages::createSuccessResponse(seq_id, "batch", result);
+}
+
+} // namespace
+
+void registerBatchCommand(CommandRegistry& registry, std::shared_ptr<CameraInterface> camera) {
+    // Flagged camera-exclusive so batches queue in the camera lane with the
+    // commands they contain
+    registry.add({
+        "batch",
+        {},
+        FLAG_CAMERA_EXCLUSIVE,
+        [&registry, camera](const json& payload, int seq_id) {
+            return handleBatch(registry, camera, payload, seq_id);
+        }
+    });
+}
@@ -0,0 +1,16 @@
+#ifndef BATCH_COMMAND_H
+#define BATCH_COMMAND_H
+
+#include <memory>
+
+class CommandRegistry;
+class CameraInterface;
+
+// Register the "batch" command
+// A batch carries an ordered list of commands and returns one response with
+// a result per item. Items are dispatched through the same registry, so any
+// registered command (except batch and handshake) can be batched. If any
+// item needs the camera, camera access is acquired once for the whole batch.
+void registerBatchCommand(CommandRegistry& registry, std::shared_ptr<CameraInterface> camera);
+
+#endif // BATCH_COMMAND_H
@@ -0,0 +1,355 @@
+#include "protocol/camera_commands.h"
+#include "protocol/command_registry.h"
+#include "protocol/command_schema.h"
+#include "protocol/messages.h"
+#include "protocol/tcp_server.h"
+#include "protocol/command_deadline.h"
+#include "camera/camera_interface.h"
+#include "utils/logger.h"
+
+namespace {
+
+// Everything registered here must be described - and marked implemented - in commands.json
+static_assert(schema::isImplemented("camera.capture"), "camera.capture missing from commands.json");
+static_assert(schema::isImplemented("camera.focus"), "camera.focus missing from commands.json");
+static_assert(schema::isImplemented("camera.auto_focus_hold"), "camera.auto_focus_hold missing from commands.json");
+static_assert(schema::isImplemented("camera.set_property"), "camera.set_property missing from commands.json");
+static_assert(schema::isImplemented("camera.get_properties"), "camera.get_properties missing from commands.json");
+static_assert(schema::isImplemented("camera.subscribe"), "camera.subscribe missing from commands.json");
+
+// Check before the camera is driven - a stale capture must not fire late
+// (CameraSony checks again once it has camera access). Returns an error response, or a null json if the command is still in time
+json checkNotExpired(const std::string& command, int seq_id) {
+    int64_t overdue_ms = 0;
+    if (!deadline::expired(&overdue_ms)) {
+        return json();
+    }
+
+    Logger::warning("Dropping stale " + command + " (" + std::to_string(overdue_ms) + "ms past deadline)");
+    return messages::createErrorResponse(
+        seq_id, command,
+        messages::ErrorCode::COMMAND_EXPIRED,
+        "Command expired " + std::to_string(overdue_ms) + "ms ago - camera not driven"
+    );
+}
+
+// Response for a camera call that returned false. If the deadline passed
+// while it waited for the camera, it was not driven - report that rather
+// than a camera fault.
+json cameraFailure(const std::string& command, int seq_id, const std::string& message) {
+    json expired = checkNotExpired(command, seq_id);
+    if (!expired.is_null()) {
+        return expired;
+    }
+    return messages::createErrorResponse(seq_id, command, messages::ErrorCode::COMMAND_FAILED, message);
+}
+
+// Common precondition for every camera command
+// Returns an error response, or a null json if the camera is usable
+json checkCameraReady(const std::shared_ptr<CameraInterface>& camera, const std::string& command,
+                      int seq_id, const std::string& what) {
+    // Check if camera is available
+    if (!camera) {
+        return messages::createErrorResponse(
+            seq_id, command,
+            messages::ErrorCode::INTERNAL_ERROR,
+            "Camera interface not initialized"
+        );
+    }
+
+    // Check if camera is connected
+    // Note: We don't attempt immediate reconnection here to avoid blocking the command handler
+    // The health check thread handles reconnection every 30 seconds
+    if (!camera->isConnected()) {
+        Logger::warning("Camera not connected - cannot " + what);
+        return messages::createErrorResponse(
+            seq_id, command,
+            messages::ErrorCode::COMMAND_FAILED,
+            "Camera not connected. Reconnection in progress, please retry in a few seconds."
+        );
+    }
+
+    return checkNotExpired(command, seq_id);
+}
+
+json handleCameraCapture(CameraInterface* camera, const json& payload, int seq_id) {
+    (void)payload; // Suppress unused parameter warning
+
+    // Trigger capture
+    Logger::info("Executing camera.capture command");
+    bool success = camera->capture();
+
+    if (!success) {
+        return cameraFailure("camera.capture", seq_id, "Failed to trigger camera shutter");
+    }
+
+    // Return success response
+    json result = {
+        {"status", "captured"},
+        {"message", "Shutter released successfully"}
+    };
+
+    return messages::createSuccessResponse(seq_id, "camera.capture", result);
+}
+
+json handleCameraFocus(CameraInterface* camera, const json& payload, int seq_id) {
+    // action/speed were checked against commands.json before the command was queued
+    auto params = schema::CameraFocusParams::from(payload);
+    const std::string& action = params.action;
+    int speed = static_cast<int>(params.speed);  // Default: 3 = fast
+
+    // Execute focus operation
+    Logger::info("Executing camera.focus command: action=" + action + ", speed=" + std::to_string(speed));
+    bool success = camera->focus(action, speed);
+
+    if (!success) {
+        return cameraFailure("camera.focus", seq_id, "Failed to execute focus action: " + action);
+    }
+
+    // Read focal distance after focus operation
+    float focal_distance_m = camera->getFocalDistanceMeters();
+
+    // Return success response
+    json result = {
+        {"action", action},
+        {"speed", speed}
+    };
+
+    // Include focal distance if available
+    if (focal_distance_m > 0.0f) {
+        result["focus_distance_m"] = focal_distance_m;
+    } else if (focal_distance_m == -1.0f) {
+        result["focus_distance_m"] = "infinity";
+    }
+    // If < 0 but not -1, omit (error reading)
+
+    return messages::createSuccessResponse(seq_id, "camera.focus", result);
+}
+
+json handleCameraAutoFocusHold(CameraInterface* camera, const json& payload, int seq_id) {
+    std::string state = schema::CameraAutoFocusHoldParams::from(payload).state;
+
+    // Execute auto-focus hold operation
+    Logger::info("Executing camera.auto_focus_hold command: state=" + state);
+    bool success = camera->autoFocusHold(state);
+
+    if (!success) {
+        return cameraFailure("camera.auto_focus_hold", seq_id, "Failed to execute auto-focus hold: " + state);
+    }
+
+    // Return success response
+    json result = {
+        {"state", state}
+    };
+
+    return messages::createSuccessResponse(seq_id, "camera.auto_focus_hold", result);
+}
+
+json handleCameraSetProperty(CameraInterface* camera, const json& payload, int seq_id) {
+    auto params = schema::CameraSetPropertyParams::from(payload);
+    const std::string& property = params.property;
+    std::string value = params.value.is_string() ?
+                        params.value.get<std::string>() :
+                        std::to_string(params.value.get<int>());
+
+    Logger::info("Executing camera.set_property: " + property + " = " + value);
+
+    // Set the property
+    bool success = camera->setProperty(property, value);
+
+    if (!success) {
+        return cameraFailure("camera.set_property", seq_id, "Failed to set camera property: " + property);
+    }
+
+    // Read back actual value from camera for verification
+    std::string actual_value = camera->getProperty(property);
+    if (!actual_value.empty()) {
+        Logger::info("Property comparison - Requested: '" + value + "' → Camera has: '" + actual_value + "'");
+    } else {
+        Logger::warning("Could not read back property value from camera");
+    }
+
+    // Return success response
+    json result = {
+        {"property", property},
+        {"value", value},
+        {"status", "success"}
+    };
+
+    return messages::createSuccessResponse(seq_id, "camera.set_property", result);
+}
+
+json handleCameraGetProperties(CameraInterface* camera, TCPServer& server, const json& payload, int seq_id) {
+    // Check if camera is connected, attempt immediate reconnection if needed
+    if (!camera->isConnected()) {
+        Logger::info("Camera not connected - attempting immediate reconnection for get_properties command");
+
+        bool reconnected = camera->connect();
+        if (reconnected) {
+            Logger::info("Camera reconnected successfully!");
+
+            // Send notification about reconnection
+            server.sendNotification(
+                messages::NotificationLevel::INFO,
+                messages::NotificationCategory::CAMERA,
+                "Camera Connected",
+                "Camera successfully reconnected and ready",
+                "",
+                true
+            );
+        } else {
+            Logger::warning("Camera reconnection failed");
+            return messages::createErrorResponse(
+                seq_id, "camera.get_properties",
+                messages::ErrorCode::COMMAND_FAILED,
+                "Camera not connected"
+            );
+        }
+    }
+
+    auto params = schema::CameraGetPropertiesParams::from(payload);
+
+    Logger::info("Executing camera.get_properties for " +
+                 std::to_string(params.properties.size()) + " properties");
+
+    // Full dumps can be streamed - each value goes out as soon as it is read
+    ResponseStream* stream = server.openStream("camera.get_properties", seq_id,
+                                               {{"properties", params.properties.size()}});
+    if (stream) {
+        for (const auto& property : params.properties) {
+            if (!stream->add(property, camera->getProperty(property))) {
+                break;
+            }
+        }
+        return json();
+    }
+
+    // Get each property
+    json result = json::object();
+    for (const auto& property : params.properties) {
+        result[property] = camera->getProperty(property);
+    }
+
+    return messages::createSuccessResponse(seq_id, "camera.get_properties", result);
+}
+
+json handleCameraSubscribe(CameraInterface* camera, TCPServer& server, const json& payload, int seq_id) {
+    // The spec only allows the properties the camera keeps cached - the
+    // ones that can report changes
+    auto params = schema::CameraSubscribeParams::from(payload);
+    const std::vector<std::string>& properties = params.properties;
+    int min_interval_ms = static_cast<int>(params.min_interval_ms);
+
+    json current = camera ? camera->getStatus().toJson().value("settings", json::object()) : json::object();
+    json values = json::object();
+    for (const auto& property : properties) {
+        if (current.contains(property)) {
+            values[property] = current[property];
+        }
+    }
+
+    if (!server.subscribeProperties(properties, min_interval_ms)) {
+        return messages::createErrorResponse(
+            seq_id, "camera.subscribe",
+            messages::ErrorCode::INTERNAL_ERROR,
+            "Subscriptions are only available on the command connection"
+        );
+    }
+
+    Logger::info("Executing camera.subscribe for " + std::to_string(properties.size()) + " properties");
+
+    // Current values let the client start in sync; events carry changes only
+    json result = {
+        {"properties", properties},
+        {"min_interval_ms", min_interval_ms},
+        {"values", values}
+    };
+    return messages::createSuccessResponse(seq_id, "camera.subscribe", result);
+}
+
+} // namespace
+
+void registerCameraCommands(CommandRegistry& registry,
+                            std::shared_ptr<CameraInterface> camera,
+                            TCPServer& server) {
+    // Wrap a handler with the shared "camera initialised and connected" check
+    auto guarded = [camera](const std::string& name, const std::string& what,
+                            json (*handler)(CameraInterface*, const json&, int)) -> CommandHandler {
+        return [camera, name, what, handler](const json& payload, int seq_id) {
+            json error = checkCameraReady(camera, name, seq_id, what);
+            if (!error.is_null()) {
+                return error;
+            }
+            return handler(camera.get(), payload, seq_id);
+        };
+    };
+
+    registry.add({
+        "camera.capture",
+        {},
+        FLAG_CAMERA_EXCLUSIVE | FLAG_CAMERA_URGENT,
+        guarded("camera.capture", "capture", handleCameraCapture)
+    });
+
+    registry.add({
+        "camera.focus",
+        {},
+        FLAG_CAMERA_EXCLUSIVE | FLAG_CAMERA_URGENT,
+        guarded("camera.focus", "focus", handleCameraFocus)
+    });
+
+    // Absolute states and values, but not idempotent: a late resend would undo
+    // a newer command
+    registry.add({
+        "camera.auto_focus_hold",
+        {},
+        FLAG_CAMERA_EXCLUSIVE | FLAG_CAMERA_URGENT,
+        guarded("camera.auto_focus_hold", "trigger auto-focus hold", handleCameraAutoFocusHold)
+    });
+
+    registry.add({
+        "camera.set_property",
+        {},
+        FLAG_CAMERA_EXCLUSIVE,
+        guarded("camera.set_property", "set property", handleCameraSetProperty),
+        "property"  // Slider drags: only the latest queued value per property is applied
+    });
+
+    // get_properties attempts an immediate reconnect instead of failing fast
+    registry.add({
+        "camera.get_properties",
+        {},
+        FLAG_CAMERA_EXCLUSIVE | FLAG_IDEMPOTENT,
+        [camera, &server](const json& payload, int seq_id) {
+            if (!camera) {
+                return messages::createErrorResponse(
+                    seq_id, "camera.get_properties",
+                    messages::ErrorCode::INTERNAL_ERROR,
+                    "Camera interface not initialized"
+                );
+            }
+            json error = checkNotExpired("camera.get_properties", seq_id);
+            if (!error.is_null()) {
+                return error;
+            }
+            return handleCameraGetProperties(camera.get(), server, payload, seq_id);
+        }
+    });
+
+    // Push instead of poll: cached property changes go to subscribed clients.
+    // Reads the cache only, so it stays off the camera lane.
+    registry.add({
+        "camera.subscribe",
+        {},
+        FLAG_IDEMPOTENT,
+        [camera, &server](const json& payload, int seq_id) {
+            return handleCameraSubscribe(camera.get(), server, payload, seq_id);
+        }
+    });
+
+    if (camera) {
+        camera->setPropertyChangeCallback([&server](const std::string& property, const std::string& value) {
+            server.publishPropertyChange(property, value);
+        });
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef CAMERA_COMMANDS_H
+#define CAMERA_COMMANDS_H
+
+#include <memory>
+
+class CommandRegistry;
+class CameraInterface;
+class TCPServer;
+
+// Register the camera.* command family
+// server is used to broadcast notifications (e.g. camera reconnected) and
+// to push property change events to camera.subscribe clients
+void registerCameraCommands(CommandRegistry& registry,
+                            std::shared_ptr<CameraInterface> camera,
+                            TCPServer& server);
+
+#endif // CAMERA_COMMANDS_H
@@ -0,0 +1,64 @@
+#include "protocol/command_coalescer.h"
+
+namespace {
+// How often a settling worker re-checks for queued work
+constexpr std::chrono::milliseconds SETTLE_POLL(5);
+}
+
+CommandCoalescer::CommandCoalescer(std::chrono::milliseconds window)
+    : window_(window) {
+}
+
+CommandCoalescer::Ticket CommandCoalescer::arrive(const std::string& key, int seq_id) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = pending_.find(key);
+        if (it != pending_.end()) {
+            superseded_[it->second.id] = seq_id;
+        }
+
+        id = next_id_++;
+        pending_[key] = Pending{id, seq_id, Clock::now()};
+    }
+    changed_.notify_all();
+    return Ticket{key, id};
+}
+
+bool CommandCoalescer::begin(const Ticket& ticket, int& superseded_by,
+                             const std::function<bool()>& others_waiting) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        auto superseded = superseded_.find(ticket.id);
+        if (superseded != superseded_.end()) {
+            superseded_by = superseded->second;
+            superseded_.erase(superseded);
+            return false;
+        }
+
+        auto it = pending_.find(ticket.key);
+        if (it == pending_.end() || it->second.id != ticket.id) {
+            return true;  // Not tracked (should not happen) - just run it
+        }
+
+        Clock::time_point settled = it->second.arrived + window_;
+        Clock::time_point now = Clock::now();
+        if (now >= settled || cancelled_ || others_waiting()) {
+            // Running now - too late for anything newer to replace it
+            pending_.erase(it);
+            return true;
+        }
+
+        changed_.wait_for(lock, std::min<Clock::duration>(settled - now, SETTLE_POLL));
+    }
+}
+
+void CommandCoalescer::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+    }
+    changed_.notify_all();
+}
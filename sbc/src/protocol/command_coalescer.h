@@ -0,0 +1,61 @@
+#ifndef COMMAND_COALESCER_H
+#define COMMAND_COALESCER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Last-writer-wins coalescing of queued commands
+// Each coalescable command names a target (e.g. "camera.set_property:iso").
+// A newer request for a target supersedes the previous one if that has not
+// started yet: the previous one is answered without being executed.
+// A request about to run also settles for up to the window, so a burst (a
+// slider drag) collapses to its final value - unless other work is queued
+// behind it, which is never delayed.
+// arrive() is called on the event loop, begin() on the worker about to run
+// the command.
+class CommandCoalescer {
+public:
+    struct Ticket {
+        std::string key;
+        uint64_t id = 0;   // 0 = not coalesced
+    };
+
+    explicit CommandCoalescer(std::chrono::milliseconds window);
+
+    // Register a request for key; supersedes the pending one, if any
+    Ticket arrive(const std::string& key, int seq_id);
+
+    // Claim a ticket before executing its command (worker thread)
+    // Waits until the request is window old, or others_waiting() returns
+    // true, or a newer request supersedes it. Returns false if superseded
+    // (superseded_by = newer sequence_id).
+    bool begin(const Ticket& ticket, int& superseded_by, const std::function<bool()>& others_waiting);
+
+    // Wake settling workers (e.g. when the server stops)
+    void cancel();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Most recent request per key, while it has not started
+    struct Pending {
+        uint64_t id;
+        int seq_id;
+        Clock::time_point arrived;
+    };
+
+    std::chrono::milliseconds window_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool cancelled_ = false;
+    uint64_t next_id_ = 1;
+    std::unordered_map<std::string, Pending> pending_;
+    std::unordered_map<uint64_t, int> superseded_;  // Ticket id -> newer sequence_id
+};
+
+#endif // COMMAND_COALESCER_H
@@ -0,0 +1,82 @@
+#include "protocol/command_deadline.h"
+
+namespace deadline {
+
+namespace {
+
+thread_local Scope* current_scope = nullptr;
+
+bool readMs(const json& v, const char* field, int64_t& value, std::string& error) {
+    if (!v.is_number_integer() || v.get<int64_t>() < 0) {
+        error = std::string(field) + " must be a non-negative integer";
+        return false;
+    }
+    value = v.get<int64_t>();
+    return true;
+}
+
+} // namespace
+
+bool fromEnvelope(const json& deadline_field, const json& max_age_field, Clock::time_point received,
+                  bool& has_deadline, Clock::time_point& deadline, std::string& error) {
+    has_deadline = false;
+
+    if (!deadline_field.is_null()) {
+        int64_t deadline_ms = 0;
+        if (!readMs(deadline_field, "deadline_ms", deadline_ms, error)) {
+            return false;
+        }
+
+        // Convert from the sender's wall clock to our monotonic clock
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        deadline = received + std::chrono::milliseconds(deadline_ms - now_ms);
+        has_deadline = true;
+    }
+
+    if (!max_age_field.is_null()) {
+        int64_t max_age_ms = 0;
+        if (!readMs(max_age_field, "max_age_ms", max_age_ms, error)) {
+            return false;
+        }
+
+        Clock::time_point age_limit = received + std::chrono::milliseconds(max_age_ms);
+        if (!has_deadline || age_limit < deadline) {
+            deadline = age_limit;
+        }
+        has_deadline = true;
+    }
+
+    return true;
+}
+
+int64_t overdueMs(Clock::time_point deadline) {
+    auto late = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - deadline);
+    return late.count() > 0 ? late.count() : 0;
+}
+
+Scope::Scope(bool has_deadline, Clock::time_point deadline)
+    : has_deadline_(has_deadline)
+    , deadline_(deadline)
+    , previous_(current_scope) {
+    current_scope = this;
+}
+
+Scope::~Scope() {
+    current_scope = previous_;
+}
+
+bool expired(int64_t* overdue_ms) {
+    Scope* scope = current_scope;
+    if (!scope || !scope->has_deadline_ || Clock::now() < scope->deadline_) {
+        return false;
+    }
+
+    scope->triggered_ = true;
+    if (overdue_ms) {
+        *overdue_ms = overdueMs(scope->deadline_);
+    }
+    return true;
+}
+
+} // namespace deadline
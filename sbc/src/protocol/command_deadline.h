@@ -0,0 +1,58 @@
+#ifndef COMMAND_DEADLINE_H
+#define COMMAND_DEADLINE_H
+
+#include <chrono>
+#include <string>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Command deadlines
+// A command envelope may carry either or both of:
+//   deadline_ms - Unix time (ms, sender's clock) after which the command
+//                 must not start. Catches commands delayed on the link.
+//   max_age_ms  - How long the command may wait on the air side after it
+//                 was received. Catches commands stuck behind a busy camera.
+// The earliest of the two applies. Commands without either never expire.
+namespace deadline {
+
+using Clock = std::chrono::steady_clock;
+
+// Work out a command's deadline from its envelope fields (null = absent)
+// Returns false with error set if a field is present but not a
+// non-negative integer. has_deadline is false when neither field is set.
+bool fromEnvelope(const json& deadline_ms, const json& max_age_ms, Clock::time_point received,
+                  bool& has_deadline, Clock::time_point& deadline, std::string& error);
+
+// Milliseconds past the deadline (0 if not yet reached)
+int64_t overdueMs(Clock::time_point deadline);
+
+// Makes a command's deadline current on the worker thread running it, so
+// code further down (e.g. just before an SDK call) can check it
+class Scope {
+public:
+    Scope(bool has_deadline, Clock::time_point deadline);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    // True if any expired() check in this scope failed
+    bool triggered() const { return triggered_; }
+
+private:
+    friend bool expired(int64_t*);
+
+    bool has_deadline_;
+    Clock::time_point deadline_;
+    bool triggered_ = false;
+    Scope* previous_;
+};
+
+// True if the command running on this thread is past its deadline
+// overdue_ms (optional) receives how late it is
+bool expired(int64_t* overdue_ms = nullptr);
+
+} // namespace deadline
+
+#endif // COMMAND_DEADLINE_H
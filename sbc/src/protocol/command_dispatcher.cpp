@@ -0,0 +1,149 @@
+#include "protocol/command_dispatcher.h"
+#include "utils/logger.h"
+
+CommandDispatcher::CommandDispatcher(size_t worker_count)
+    : worker_count_(worker_count > 0 ? worker_count : 1)
+    , camera_active_(false)
+    , stopping_(false)
+    , running_(false)
+{
+}
+
+CommandDispatcher::~CommandDispatcher() {
+    stop();
+}
+
+void CommandDispatcher::start() {
+    if (running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+    }
+
+    running_ = true;
+    for (size_t i = 0; i < worker_count_; ++i) {
+        workers_.emplace_back(&CommandDispatcher::workerLoop, this);
+    }
+
+    Logger::info("Command dispatcher started (" + std::to_string(worker_count_) + " workers)");
+}
+
+void CommandDispatcher::stop() {
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+
+    size_t dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dropped = general_queue_.size() + cameraPending();
+        general_queue_.clear();
+        for (auto& queue : camera_queues_) {
+            queue.clear();
+        }
+        camera_active_ = false;
+    }
+
+    running_ = false;
+
+    if (dropped > 0) {
+        Logger::warning("Command dispatcher stopped with " + std::to_string(dropped) + " queued commands");
+    }
+}
+
+void CommandDispatcher::submit(Lane lane, std::function<void()> job, CameraAccess::Priority priority) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (lane == Lane::CAMERA) {
+            camera_queues_[static_cast<size_t>(priority)].push_back(std::move(job));
+        } else {
+            general_queue_.push_back(std::move(job));
+        }
+    }
+    cv_.notify_one();
+}
+
+size_t CommandDispatcher::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return general_queue_.size() + cameraPending();
+}
+
+size_t CommandDispatcher::pending(Lane lane) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lane == Lane::CAMERA ? cameraPending() : general_queue_.size();
+}
+
+size_t CommandDispatcher::cameraPending() const {
+    size_t count = 0;
+    for (const auto& queue : camera_queues_) {
+        count += queue.size();
+    }
+    return count;
+}
+
+void CommandDispatcher::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        bool camera_job = false;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] {
+                return stopping_ || !general_queue_.empty() ||
+                       (!camera_active_ && cameraPending() > 0);
+            });
+
+            if (stopping_) {
+                return;
+            }
+
+            // Camera work first - it is the latency-critical lane - and
+            // within it the most urgent class
+            if (!camera_active_ && cameraPending() > 0) {
+                for (auto& queue : camera_queues_) {
+                    if (!queue.empty()) {
+                        job = std::move(queue.front());
+                        queue.pop_front();
+                        break;
+                    }
+                }
+                camera_active_ = true;
+                camera_job = true;
+            } else {
+                job = std::move(general_queue_.front());
+                general_queue_.pop_front();
+            }
+        }
+
+        try {
+            job();
+        } catch (const std::exception& e) {
+            Logger::error("Exception in command worker: " + std::string(e.what()));
+        }
+
+        if (camera_job) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                camera_active_ = false;
+            }
+            // The next camera job may be waiting for any worker
+            cv_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef COMMAND_DISPATCHER_H
+#define COMMAND_DISPATCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "camera/camera_access.h"
+
+// Worker pool that executes commands off the TCP event loop
+// Two lanes share the pool:
+//   GENERAL - runs as soon as a worker is free (status, handshake, ...)
+//   CAMERA  - camera-exclusive commands, run one at a time so pipelined
+//             camera commands queue instead of failing "camera busy"
+// A slow camera operation therefore never delays a cheap command.
+//
+// The camera lane is ordered by the CameraAccess priority classes: the
+// next job is the oldest of the most urgent class waiting, so a capture
+// waits for at most the job already running, not for every queued
+// property read and write. Within a class the order is FIFO.
+class CommandDispatcher {
+public:
+    enum class Lane { GENERAL, CAMERA };
+
+    explicit CommandDispatcher(size_t worker_count);
+    ~CommandDispatcher();
+
+    // Start the worker threads
+    void start();
+
+    // Stop the workers (waits for running jobs, drops queued ones)
+    void stop();
+
+    // Queue a job (thread-safe). priority orders the camera lane only.
+    void submit(Lane lane, std::function<void()> job,
+                CameraAccess::Priority priority = CameraAccess::Priority::PROPERTY);
+
+    // Jobs queued but not yet started
+    size_t pending() const;
+
+    // Jobs queued in one lane but not yet started
+    size_t pending(Lane lane) const;
+
+private:
+    // Worker thread main loop
+    void workerLoop();
+
+    // Jobs queued in the camera lane (mutex_ held)
+    size_t cameraPending() const;
+
+    size_t worker_count_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> general_queue_;
+    static constexpr size_t CAMERA_CLASS_COUNT =
+        static_cast<size_t>(CameraAccess::Priority::BACKGROUND) + 1;
+    std::deque<std::function<void()>> camera_queues_[CAMERA_CLASS_COUNT];  // By priority class
+    bool camera_active_;    // A camera-lane job is currently running
+    bool stopping_;
+    std::atomic<bool> running_;
+};
+
+#endif // COMMAND_DISPATCHER_H
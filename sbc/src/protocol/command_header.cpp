@@ -0,0 +1,360 @@
+#include "protocol/command_header.h"
+#include "config.h"
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace {
+
+// Builds one JSON value from SAX events (a captured payload member)
+class ValueBuilder {
+public:
+    explicit ValueBuilder(json& root) : root_(root) {}
+
+    void add(json value) {
+        place(std::move(value));
+    }
+
+    void startContainer(json container) {
+        open_.push_back(place(std::move(container)));
+    }
+
+    void endContainer() {
+        open_.pop_back();
+    }
+
+    void key(const json::string_t& name) {
+        member_ = &(*open_.back())[name];
+    }
+
+private:
+    // Put a value where the events say it goes; returns where it went
+    json* place(json value) {
+        if (open_.empty()) {
+            root_ = std::move(value);
+            return &root_;
+        }
+        json& parent = *open_.back();
+        if (parent.is_array()) {
+            parent.push_back(std::move(value));
+            return &parent.back();
+        }
+        *member_ = std::move(value);
+        return member_;
+    }
+
+    json& root_;
+    std::vector<json*> open_;   // Containers still being filled, innermost last
+    json* member_ = nullptr;    // Object member the next value goes into
+};
+
+// SAX consumer that records the envelope fields and builds a DOM only for
+// payload members other than the command name
+class HeaderScanner final : public nlohmann::json_sax<json> {
+public:
+    explicit HeaderScanner(CommandHeader& header) : header_(header) {}
+
+    const std::string& error() const { return error_; }
+
+    bool null() override {
+        if (capture_) {
+            capture_->add(json());
+            return captured();
+        }
+        return scalar(json());
+    }
+
+    bool boolean(bool value) override {
+        if (capture_) {
+            capture_->add(value);
+            return captured();
+        }
+        return scalar(json(value));
+    }
+
+    bool number_integer(json::number_integer_t value) override {
+        if (capture_) {
+            capture_->add(value);
+            return captured();
+        }
+        return scalar(json(value));
+    }
+
+    bool number_unsigned(json::number_unsigned_t value) override {
+        if (capture_) {
+            capture_->add(value);
+            return captured();
+        }
+        return scalar(json(value));
+    }
+
+    bool number_float(json::number_float_t value, const json::string_t&) override {
+        if (capture_) {
+            capture_->add(value);
+            return captured();
+        }
+        return scalar(json(value));
+    }
+
+    bool binary(json::binary_t& value) override {
+        if (capture_) {
+            capture_->add(json::binary(std::move(value)));
+            return captured();
+        }
+        return scalar(json());
+    }
+
+    bool string(json::string_t& value) override {
+        if (capture_) {
+            capture_->add(std::move(value));
+            return captured();
+        }
+        if (depth_ == 1 && top_is_object_) {
+            if (top_key_ == TopKey::PROTOCOL_VERSION) {
+                header_.has_protocol_version = true;
+                header_.protocol_version = value;
+                return true;
+            }
+            if (top_key_ == TopKey::MESSAGE_TYPE) {
+                header_.has_message_type = true;
+                header_.message_type = value;
+                return true;
+            }
+        } else if (depth_ == 2 && in_payload_) {
+            header_.has_command = true;
+            header_.command = value;
+            return true;
+        }
+        return scalar(json());  // No header field takes any other string - no need to copy it
+    }
+
+    bool start_object(std::size_t) override {
+        if (capture_) {
+            ++capture_depth_;
+            capture_->startContainer(json::object());
+            return true;
+        }
+        return startContainer(true);
+    }
+
+    bool start_array(std::size_t) override {
+        if (capture_) {
+            ++capture_depth_;
+            capture_->startContainer(json::array());
+            return true;
+        }
+        return startContainer(false);
+    }
+
+    bool end_object() override {
+        if (capture_) {
+            --capture_depth_;
+            capture_->endContainer();
+            return captured();
+        }
+        return endContainer();
+    }
+
+    bool end_array() override {
+        if (capture_) {
+            --capture_depth_;
+            capture_->endContainer();
+            return captured();
+        }
+        return endContainer();
+    }
+
+    bool key(json::string_t& name) override {
+        if (capture_) {
+            capture_->key(name);
+            return true;
+        }
+
+        if (depth_ == 1 && top_is_object_) {
+            top_key_ = name == "protocol_version" ? TopKey::PROTOCOL_VERSION :
+                       name == "message_type"     ? TopKey::MESSAGE_TYPE :
+                       name == "sequence_id"      ? TopKey::SEQUENCE_ID :
+                       name == "payload"          ? TopKey::PAYLOAD :
+                       name == "deadline_ms"      ? TopKey::DEADLINE_MS :
+                       name == "max_age_ms"       ? TopKey::MAX_AGE_MS :
+                       name == "stream"           ? TopKey::STREAM :
+                                                    TopKey::OTHER;
+        } else if (depth_ == 2 && in_payload_ && name != "command") {
+            // Everything in the payload but the command name goes into the DOM
+            if (!header_.payload_fields.is_object()) {
+                header_.payload_fields = json::object();
+            }
+            capture_is_parameters_ = name == "parameters";
+            if (!capture_is_parameters_) {
+                header_.needs_document = true;
+            }
+            capture_depth_ = 0;
+            capture_.emplace(header_.payload_fields[name]);
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const json::exception& e) override {
+        error_ = e.what();
+        return false;
+    }
+
+private:
+    enum class TopKey { OTHER, PROTOCOL_VERSION, MESSAGE_TYPE, SEQUENCE_ID, PAYLOAD, DEADLINE_MS, MAX_AGE_MS, STREAM };
+
+    // After a captured event: stop capturing once the member's value is complete
+    bool captured() {
+        if (capture_depth_ == 0) {
+            capture_.reset();
+            if (capture_is_parameters_) {
+                const json& parameters = header_.payload_fields["parameters"];
+                if (!parameters.is_object() || !parameters.empty()) {
+                    header_.needs_document = true;  // Not an object - let the schema check report it
+                }
+            }
+        }
+        return true;
+    }
+
+    // A scalar value (or a container standing in for one)
+    bool scalar(const json& value) {
+        if (depth_ == 1 && top_is_object_) {
+            switch (top_key_) {
+                case TopKey::PROTOCOL_VERSION:
+                    header_.has_protocol_version = true;
+                    break;
+                case TopKey::MESSAGE_TYPE:
+                    header_.has_message_type = true;
+                    break;
+                case TopKey::SEQUENCE_ID:
+                    header_.has_sequence_id = true;
+                    if (value.is_number_integer() &&
+                        value.get<int64_t>() >= std::numeric_limits<int>::min() &&
+                        value.get<int64_t>() <= std::numeric_limits<int>::max()) {
+                        header_.sequence_id = value.get<int>();
+                        header_.sequence_id_valid = true;
+                    }
+                    break;
+                case TopKey::PAYLOAD:
+                    header_.has_payload = true;
+                    break;
+                case TopKey::DEADLINE_MS:
+                    header_.deadline_ms = value.is_null() ? json::array() : value;
+                    break;
+                case TopKey::MAX_AGE_MS:
+                    header_.max_age_ms = value.is_null() ? json::array() : value;
+                    break;
+                case TopKey::STREAM:
+                    header_.stream = value.is_boolean() && value.get<bool>();
+                    break;
+                case TopKey::OTHER:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    bool startContainer(bool is_object) {
+        if (depth_ == 0) {
+            top_is_object_ = is_object;
+        } else if (depth_ == 1 && top_is_object_) {
+            if (top_key_ == TopKey::PAYLOAD) {
+                header_.has_payload = true;
+                in_payload_ = is_object;
+            } else {
+                scalar(json());  // Wrong type for any header field
+            }
+        }
+        ++depth_;
+        return true;
+    }
+
+    bool endContainer() {
+        --depth_;
+        if (depth_ == 1) {
+            in_payload_ = false;
+        }
+        return true;
+    }
+
+    CommandHeader& header_;
+    std::string error_;
+    int depth_ = 0;
+    bool top_is_object_ = false;
+    bool in_payload_ = false;
+    TopKey top_key_ = TopKey::OTHER;
+
+    // Payload member currently being built into header_.payload_fields
+    std::optional<ValueBuilder> capture_;
+    int capture_depth_ = 0;
+    bool capture_is_parameters_ = false;
+};
+
+} // namespace
+
+json CommandHeader::takePayload() {
+    json payload = payload_fields.is_object() ? std::move(payload_fields) : json::object();
+    payload_fields = json();
+
+    if (has_command) {
+        payload["command"] = command;
+    }
+    if (!payload.contains("parameters")) {
+        payload["parameters"] = json::object();
+    }
+    return payload;
+}
+
+bool scanCommandHeader(std::string_view frame, wire::Encoding encoding,
+                       CommandHeader& header, std::string& error) {
+    json::input_format_t format = encoding == wire::Encoding::CBOR    ? json::input_format_t::cbor :
+                                  encoding == wire::Encoding::MSGPACK ? json::input_format_t::msgpack :
+                                                                        json::input_format_t::json;
+
+    HeaderScanner scanner(header);
+    if (!json::sax_parse(frame.begin(), frame.end(), &scanner, format)) {
+        error = scanner.error().empty() ? "malformed message" : scanner.error();
+        return false;
+    }
+    return true;
+}
+
+bool validateCommandHeader(const CommandHeader& header, std::string& error) {
+    if (!header.has_protocol_version) {
+        error = "Missing protocol_version";
+        return false;
+    }
+
+    if (header.protocol_version != config::PROTOCOL_VERSION) {
+        error = "Invalid protocol version: " + header.protocol_version;
+        return false;
+    }
+
+    if (!header.has_message_type) {
+        error = "Missing message_type";
+        return false;
+    }
+
+    if (!header.has_sequence_id) {
+        error = "Missing sequence_id";
+        return false;
+    }
+
+    if (!header.sequence_id_valid) {
+        error = "Invalid sequence_id";
+        return false;
+    }
+
+    if (!header.has_payload) {
+        error = "Missing payload";
+        return false;
+    }
+
+    // Special case: handshake messages don't need "command" field
+    if (header.message_type != "handshake" && !header.has_command) {
+        error = "Missing command in payload";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef COMMAND_HEADER_H
+#define COMMAND_HEADER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+#include "protocol/wire_format.h"
+
+using json = nlohmann::json;
+
+// Envelope of an incoming message, read in one streaming (SAX) pass
+// Everything needed to validate, route and answer a command is taken from
+// the header without building a document. Only payload members other than
+// the command name (parameters, handshake fields) are built into a DOM -
+// in the same pass - since those are what handlers actually read.
+struct CommandHeader {
+    bool has_protocol_version = false;
+    bool has_message_type = false;
+    bool has_sequence_id = false;
+    bool has_payload = false;
+    bool has_command = false;
+
+    std::string protocol_version;   // Empty if present but not a string
+    std::string message_type;
+    int sequence_id = 0;
+    bool sequence_id_valid = false; // Present and an integer in range
+    std::string command;            // payload.command
+
+    // Optional envelope fields (null when absent)
+    json deadline_ms;
+    json max_age_ms;
+    bool stream = false;            // "stream": true - the client accepts a streamed result
+
+    // Payload members other than "command" (null if there are none)
+    json payload_fields;
+
+    // payload has non-empty parameters or other fields (e.g. handshake)
+    bool needs_document = false;
+
+    // Payload to hand to a handler: the captured fields plus the command
+    // name (if sent), with empty parameters if none were sent. Leaves
+    // payload_fields null.
+    json takePayload();
+};
+
+// Scan one frame (body without framing) in the given encoding
+// Returns false with error set if the frame is not well-formed
+bool scanCommandHeader(std::string_view frame, wire::Encoding encoding,
+                       CommandHeader& header, std::string& error);
+
+// Check the envelope has everything needed to dispatch the message
+// Returns false with error describing the first problem
+bool validateCommandHeader(const CommandHeader& header, std::string& error);
+
+#endif // COMMAND_HEADER_H
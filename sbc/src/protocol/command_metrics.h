@@ -0,0 +1,27 @@
+#ifndef COMMAND_METRICS_H
+#define COMMAND_METRICS_H
+
+#include <nlohmann/json.hpp>
+#include "utils/latency_histogram.h"
+
+using json = nlohmann::json;
+
+// Where a command's time went, recorded by the worker that ran it
+struct CommandMetrics {
+    LatencyHistogram queue_wait;   // Submitted until a worker picked it up
+    LatencyHistogram camera_wait;  // Blocked waiting for camera access
+    LatencyHistogram sdk;          // Holding camera access (SDK calls)
+    LatencyHistogram total;        // Submitted until the response was encoded
+
+    json toJson() const {
+        return {
+            {"count", total.count()},
+            {"queue_wait_ms", queue_wait.summaryMs()},
+            {"camera_wait_ms", camera_wait.summaryMs()},
+            {"sdk_ms", sdk.summaryMs()},
+            {"total_ms", total.summaryMs()}
+        };
+    }
+};
+
+#endif // COMMAND_METRICS_H
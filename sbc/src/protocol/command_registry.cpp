@@ -0,0 +1,133 @@
+#include "protocol/command_registry.h"
+#include "protocol/command_schema.h"
+#include "utils/logger.h"
+#include <algorithm>
+
+void CommandRegistry::add(CommandSpec spec) {
+    std::string name = spec.name;
+
+    // commands.json is the source of truth for anything it describes
+    if (const schema::CommandInfo* info = schema::findCommand(name)) {
+        if (!spec.params.empty()) {
+            Logger::warning("Command registry: " + name + " parameters come from commands.json - "
+                            "ignoring the registered list");
+            spec.params.clear();
+        }
+        if (!info->air_side) {
+            Logger::warning("Command registry: " + name + " is not marked implemented (air_side) in commands.json");
+        }
+        spec.validate = info->validate;
+    }
+
+    if (commands_.count(name) > 0) {
+        Logger::warning("Command registry: replacing handler for " + name);
+    }
+    commands_[name] = std::move(spec);
+    Logger::debug("Command registry: registered " + name);
+}
+
+const CommandSpec* CommandRegistry::find(const std::string& name) const {
+    auto it = commands_.find(name);
+    return it == commands_.end() ? nullptr : &it->second;
+}
+
+static std::string formatBound(const std::optional<double>& bound, const char* unbounded) {
+    if (!bound) {
+        return unbounded;
+    }
+    double value = *bound;
+    if (value == static_cast<double>(static_cast<long long>(value))) {
+        return std::to_string(static_cast<long long>(value));
+    }
+    return json(value).dump();
+}
+
+static bool matchesType(const json& value, const std::string& type) {
+    if (type == "string")  return value.is_string();
+    if (type == "integer") return value.is_number_integer();
+    if (type == "number")  return value.is_number();
+    if (type == "boolean") return value.is_boolean();
+    if (type == "array")   return value.is_array();
+    if (type == "object")  return value.is_object();
+    return true;  // "any"
+}
+
+bool CommandRegistry::validateParameters(const CommandSpec& spec, const json& payload,
+                                         messages::ErrorCode& error_code, std::string& error) const {
+    if (spec.validate) {
+        return spec.validate(payload, error_code, error);
+    }
+
+    if (spec.params.empty()) {
+        return true;
+    }
+
+    bool has_params = payload.contains("parameters") && payload["parameters"].is_object();
+    bool any_required = std::any_of(spec.params.begin(), spec.params.end(),
+                                    [](const ParamSpec& p) { return p.required; });
+
+    if (!has_params) {
+        if (any_required) {
+            error_code = messages::ErrorCode::MISSING_REQUIRED_FIELD;
+            error = "Missing required 'parameters' object";
+            return false;
+        }
+        return true;
+    }
+
+    const json& params = payload["parameters"];
+
+    for (const auto& param : spec.params) {
+        if (!params.contains(param.name)) {
+            if (param.required) {
+                error_code = messages::ErrorCode::MISSING_REQUIRED_FIELD;
+                error = "Missing required field: " + param.name;
+                return false;
+            }
+            continue;
+        }
+
+        const json& value = params[param.name];
+
+        if (!matchesType(value, param.type)) {
+            error_code = messages::ErrorCode::INVALID_PARAMETER;
+            error = "Parameter '" + param.name + "' must be of type " + param.type;
+            return false;
+        }
+
+        if (!param.allowed.empty()) {
+            const std::string& str = value.get_ref<const std::string&>();
+            if (std::find(param.allowed.begin(), param.allowed.end(), str) == param.allowed.end()) {
+                std::string valid;
+                for (const auto& v : param.allowed) {
+                    valid += (valid.empty() ? "" : ", ") + v;
+                }
+                error_code = messages::ErrorCode::INVALID_PARAMETER;
+                error = "Invalid " + param.name + " value: " + str + " (valid: " + valid + ")";
+                return false;
+            }
+        }
+
+        if (value.is_number() && (param.minimum || param.maximum)) {
+            double number = value.get<double>();
+            if ((param.minimum && number < *param.minimum) || (param.maximum && number > *param.maximum)) {
+                error_code = messages::ErrorCode::INVALID_PARAMETER;
+                error = "Invalid " + param.name + " value: " + value.dump() + " (valid: " +
+                        formatBound(param.minimum, "-inf") + "-" + formatBound(param.maximum, "inf") + ")";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+std::vector<std::string> CommandRegistry::names() const {
+    std::vector<std::string> result;
+    result.reserve(commands_.size());
+    for (const auto& entry : commands_) {
+        result.push_back(entry.first);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
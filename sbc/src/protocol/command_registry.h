@@ -0,0 +1,86 @@
+#ifndef COMMAND_REGISTRY_H
+#define COMMAND_REGISTRY_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "protocol/messages.h"
+
+using json = nlohmann::json;
+
+// Behaviour flags declared by each command
+enum CommandFlags : uint32_t {
+    FLAG_NONE             = 0,
+    FLAG_IDEMPOTENT       = 1u << 0,  // A resend may simply run again, even after later
+                                      // commands (reads); not cached for retries
+    FLAG_CAMERA_EXCLUSIVE = 1u << 1,  // Needs exclusive access to the camera SDK
+    FLAG_CAMERA_URGENT    = 1u << 3   // Camera lane: runs ahead of queued property work
+                                      // (shutter, focus - CameraAccess CAPTURE class)
+};
+
+// Schema for one entry of payload.parameters
+struct ParamSpec {
+    std::string name;
+    std::string type = "any";               // string, integer, number, boolean, array, object, any
+    bool required = false;
+    std::vector<std::string> allowed = {};  // Enumerated string values (empty = any)
+    std::optional<double> minimum = {};
+    std::optional<double> maximum = {};
+};
+
+// Checks payload.parameters; on failure fills error_code/error and returns false
+using ParamValidator = bool (*)(const json& payload, messages::ErrorCode& error_code, std::string& error);
+
+// Command handler - receives the message payload and sequence id,
+// returns the complete response message
+using CommandHandler = std::function<json(const json& payload, int seq_id)>;
+
+struct CommandSpec {
+    std::string name;
+    std::vector<ParamSpec> params;  // Only for commands not in protocol/commands.json
+    uint32_t flags = FLAG_NONE;
+    CommandHandler handler;
+    std::string coalesce_by = {};  // Parameter naming the target of a last-writer-wins
+                                   // command; queued requests for the same target are
+                                   // superseded by newer ones (empty = never coalesced)
+    ParamValidator validate = nullptr;  // Generated from protocol/commands.json; set by
+                                        // CommandRegistry::add() for commands in the spec
+
+    bool has(CommandFlags flag) const { return (flags & flag) != 0; }
+};
+
+// Table of every command the server understands
+// Command families register themselves at startup (before TCPServer::start());
+// dispatch is a single hash lookup and the handshake capability list is
+// generated from the same table. Parameters of commands described in
+// protocol/commands.json are checked by validators generated from it at
+// build time (protocol/command_schema.h), not by hand-written ParamSpecs. The registry is read-only once the server
+// is running, so lookups need no locking.
+class CommandRegistry {
+public:
+    // Register a command (replaces an existing entry with the same name)
+    // Attaches the generated validator if the command is in the spec
+    void add(CommandSpec spec);
+
+    // Look up a command, nullptr if unknown
+    const CommandSpec* find(const std::string& name) const;
+
+    // Validate payload.parameters against the command's schema
+    // On failure fills error_code/error and returns false
+    bool validateParameters(const CommandSpec& spec, const json& payload,
+                            messages::ErrorCode& error_code, std::string& error) const;
+
+    // Sorted list of registered command names (handshake capabilities)
+    std::vector<std::string> names() const;
+
+    size_t size() const { return commands_.size(); }
+
+private:
+    std::unordered_map<std::string, CommandSpec> commands_;
+};
+
+#endif // COMMAND_REGISTRY_H
@@ -0,0 +1,177 @@
+#include "protocol/frame_reader.h"
+#include "config.h"
+#include <algorithm>
+#include <cstring>
+
+FrameReader::FrameReader(size_t max_frame_size)
+    : storage_(max_frame_size + config::TCP_BUFFER_SIZE)
+    , max_frame_size_(max_frame_size)
+{
+}
+
+char* FrameReader::writePtr() {
+    size_t tail = (head_ + size_) % storage_.size();
+    return storage_.data() + tail;
+}
+
+size_t FrameReader::writeSpace() const {
+    if (size_ == storage_.size()) {
+        return 0;
+    }
+
+    size_t tail = (head_ + size_) % storage_.size();
+    if (tail >= head_) {
+        return storage_.size() - tail;  // Up to the end of storage
+    }
+    return head_ - tail;                // Up to the first buffered byte
+}
+
+void FrameReader::commitWrite(size_t n) {
+    size_ += n;
+}
+
+void FrameReader::setFraming(Framing framing) {
+    framing_ = framing;
+    scanned_ = 0;
+    discarding_ = false;
+    discard_remaining_ = 0;
+}
+
+FrameReader::Result FrameReader::nextFrame(std::string_view& frame) {
+    return framing_ == Framing::NEWLINE ? nextLine(frame) : nextLengthPrefixed(frame);
+}
+
+FrameReader::Result FrameReader::nextLine(std::string_view& frame) {
+    while (true) {
+        size_t newline = findNewline();
+
+        if (newline == std::string_view::npos) {
+            scanned_ = size_;
+
+            if (discarding_) {
+                consume(size_);
+                return Result::NEED_MORE;
+            }
+
+            if (size_ > max_frame_size_) {
+                // Never going to fit - drop it and skip to the next newline
+                consume(size_);
+                discarding_ = true;
+                return Result::OVERSIZE;
+            }
+
+            return Result::NEED_MORE;
+        }
+
+        if (discarding_) {
+            // Tail end of a frame already reported as oversize
+            consume(newline + 1);
+            discarding_ = false;
+            continue;
+        }
+
+        if (newline > max_frame_size_) {
+            consume(newline + 1);
+            return Result::OVERSIZE;
+        }
+
+        if (head_ + newline > storage_.size()) {
+            linearize();
+        }
+
+        frame = std::string_view(storage_.data() + head_, newline);
+        consume(newline + 1);
+
+        // Skip blank lines (keep-alives, stray "\r\n")
+        size_t first = frame.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) {
+            continue;
+        }
+
+        return frame[first] == '{' ? Result::FRAME : Result::GARBAGE;
+    }
+}
+
+FrameReader::Result FrameReader::nextLengthPrefixed(std::string_view& frame) {
+    constexpr size_t PREFIX = 4;
+
+    while (true) {
+        discardPending();
+        if (discard_remaining_ > 0 || size_ < PREFIX) {
+            return Result::NEED_MORE;
+        }
+
+        size_t length = (static_cast<size_t>(byteAt(0)) << 24) |
+                        (static_cast<size_t>(byteAt(1)) << 16) |
+                        (static_cast<size_t>(byteAt(2)) << 8) |
+                        static_cast<size_t>(byteAt(3));
+
+        if (length > max_frame_size_) {
+            // Skip the body as it arrives - it is never buffered whole
+            consume(PREFIX);
+            discard_remaining_ = length;
+            discardPending();
+            return Result::OVERSIZE;
+        }
+
+        if (size_ < PREFIX + length) {
+            return Result::NEED_MORE;
+        }
+
+        if (length == 0) {
+            consume(PREFIX);  // Empty frame - keep-alive
+            continue;
+        }
+
+        if (head_ + PREFIX + length > storage_.size()) {
+            linearize();
+        }
+
+        frame = std::string_view(storage_.data() + head_ + PREFIX, length);
+        consume(PREFIX + length);
+        return Result::FRAME;
+    }
+}
+
+void FrameReader::discardPending() {
+    size_t n = std::min(discard_remaining_, size_);
+    if (n > 0) {
+        consume(n);
+        discard_remaining_ -= n;
+    }
+}
+
+size_t FrameReader::findNewline() const {
+    size_t capacity = storage_.size();
+    size_t start = scanned_;
+
+    while (start < size_) {
+        size_t pos = (head_ + start) % capacity;
+        size_t run = std::min(size_ - start, capacity - pos);
+
+        const void* hit = std::memchr(storage_.data() + pos, '\n', run);
+        if (hit != nullptr) {
+            return start + static_cast<size_t>(static_cast<const char*>(hit) - (storage_.data() + pos));
+        }
+        start += run;
+    }
+
+    return std::string_view::npos;
+}
+
+void FrameReader::consume(size_t n) {
+    head_ = (head_ + n) % storage_.size();
+    size_ -= n;
+    scanned_ = 0;
+
+    if (size_ == 0) {
+        head_ = 0;  // Maximise contiguous space for the next recv()
+    }
+}
+
+void FrameReader::linearize() {
+    // In-place rotation - no allocation. Only happens when a frame straddles
+    // the end of the storage, i.e. at most once per lap of the ring.
+    std::rotate(storage_.begin(), storage_.begin() + static_cast<std::ptrdiff_t>(head_), storage_.end());
+    head_ = 0;
+}
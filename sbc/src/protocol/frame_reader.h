@@ -0,0 +1,80 @@
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Inbound framing for one TCP connection
+// Bytes are received straight into a fixed-capacity ring buffer and split
+// in place, either on '\n' (JSON) or by a 4-byte big-endian length prefix
+// (binary encodings). Frames are handed out as string_views into the ring,
+// so framing a message never allocates once the connection is set up.
+class FrameReader {
+public:
+    enum class Framing {
+        NEWLINE,          // One JSON message per line
+        LENGTH_PREFIXED   // uint32 big-endian length, then that many bytes
+    };
+
+    enum class Result {
+        NEED_MORE,  // No complete frame buffered
+        FRAME,      // frame holds the next message
+        GARBAGE,    // frame holds a line that is not a JSON object (NEWLINE only)
+        OVERSIZE    // A frame longer than the maximum was discarded
+    };
+
+    explicit FrameReader(size_t max_frame_size);
+
+    // Contiguous free space for the next recv(). May be shorter than the
+    // total free space when the ring wraps.
+    char* writePtr();
+    size_t writeSpace() const;
+
+    // Mark n bytes written at writePtr() as received
+    void commitWrite(size_t n);
+
+    // Switch framing for subsequent bytes (after an encoding is negotiated)
+    void setFraming(Framing framing);
+    Framing framing() const { return framing_; }
+
+    // Extract the next frame (without the newline or length prefix). The view is
+    // only valid until the next call to nextFrame() or commitWrite().
+    Result nextFrame(std::string_view& frame);
+
+    // Number of bytes buffered but not yet framed
+    size_t buffered() const { return size_; }
+
+    size_t maxFrameSize() const { return max_frame_size_; }
+
+private:
+    Result nextLine(std::string_view& frame);
+    Result nextLengthPrefixed(std::string_view& frame);
+
+    // Offset (from head) of the first '\n' at or after scanned_, or npos
+    size_t findNewline() const;
+
+    // Buffered byte at offset i from head (handles wrap-around)
+    uint8_t byteAt(size_t i) const { return static_cast<uint8_t>(storage_[(head_ + i) % storage_.size()]); }
+
+    // Drop up to discard_remaining_ buffered bytes of an oversize binary frame
+    void discardPending();
+
+    // Drop n bytes from the front of the ring
+    void consume(size_t n);
+
+    // Rotate the ring so the buffered bytes start at offset 0
+    void linearize();
+
+    std::vector<char> storage_;
+    size_t head_ = 0;           // Offset of the first buffered byte
+    size_t size_ = 0;           // Number of buffered bytes
+    size_t scanned_ = 0;        // Bytes after head_ known not to contain '\n'
+    size_t max_frame_size_;
+    bool discarding_ = false;   // Skipping the rest of an oversize line
+    size_t discard_remaining_ = 0;  // Bytes of an oversize binary frame still to skip
+    Framing framing_ = Framing::NEWLINE;
+};
+
+#endif // FRAME_READER_H
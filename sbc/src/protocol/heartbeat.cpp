@@ -11,6 +11,7 @@
 #include <errno.h>
 #include <chrono>
 #include <thread>
+#include <algorithm>
 
 Heartbeat::Heartbeat(int port, const std::string& default_target_ip)
     : socket_fd_(-1)
@@ -23,6 +24,7 @@ Heartbeat::Heartbeat(int port, const std::string& default_target_ip)
 {
     // Add default target to client list
     client_ips_.insert(default_target_ip);
+    sent_.fill({-1, std::chrono::steady_clock::time_point{}});
 }
 
 Heartbeat::~Heartbeat() {
@@ -35,23 +37,28 @@ void Heartbeat::start() {
         return;
     }
 
-    // Create UDP socket
-    socket_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    // A replacement process starts on the socket of the one it replaces
     if (socket_fd_ < 0) {
-        Logger::error("Failed to create heartbeat socket: " + std::string(strerror(errno)));
-        throw std::runtime_error("Failed to create heartbeat socket");
-    }
+        // Create UDP socket
+        socket_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (socket_fd_ < 0) {
+            Logger::error("Failed to create heartbeat socket: " + std::string(strerror(errno)));
+            throw std::runtime_error("Failed to create heartbeat socket");
+        }
 
-    // Bind socket for receiving
-    struct sockaddr_in bind_addr{};
-    bind_addr.sin_family = AF_INET;
-    bind_addr.sin_addr.s_addr = INADDR_ANY;
-    bind_addr.sin_port = htons(port_);
+        // Bind socket for receiving
+        struct sockaddr_in bind_addr{};
+        bind_addr.sin_family = AF_INET;
+        bind_addr.sin_addr.s_addr = INADDR_ANY;
+        bind_addr.sin_port = htons(port_);
 
-    if (bind(socket_fd_, (struct sockaddr*)&bind_addr, sizeof(bind_addr)) < 0) {
-        close(socket_fd_);
-        Logger::error("Failed to bind heartbeat socket: " + std::string(strerror(errno)));
-        throw std::runtime_error("Failed to bind heartbeat socket");
+        if (bind(socket_fd_, (struct sockaddr*)&bind_addr, sizeof(bind_addr)) < 0) {
+            close(socket_fd_);
+            Logger::error("Failed to bind heartbeat socket: " + std::string(strerror(errno)));
+            throw std::runtime_error("Failed to bind heartbeat socket");
+        }
+    } else {
+        Logger::info("Using inherited heartbeat socket");
     }
 
     // Set receive timeout (non-blocking with timeout)
@@ -61,7 +68,10 @@ void Heartbeat::start() {
     setsockopt(socket_fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
 
     running_ = true;
-    last_received_ = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(link_mutex_);
+        last_received_ = std::chrono::steady_clock::now();
+    }
 
     Logger::info("Heartbeat started (port " + std::to_string(port_) + ", default target: " + default_target_ip_ + ")");
 
@@ -98,6 +108,7 @@ void Heartbeat::stop() {
 
 double Heartbeat::getTimeSinceLastHeartbeat() const {
     auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(link_mutex_);
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_received_);
     return duration.count() / 1000.0;
 }
@@ -116,6 +127,10 @@ void Heartbeat::addClient(const std::string& client_ip) {
 
 void Heartbeat::removeClient(const std::string& client_ip) {
     std::lock_guard<std::mutex> lock(clients_mutex_);
+    {
+        std::lock_guard<std::mutex> link_lock(link_mutex_);
+        ground_links_.erase(client_ip);
+    }
     if (client_ips_.erase(client_ip) > 0) {
         Logger::info("Heartbeat: Removed client " + client_ip + " (remaining clients: " + std::to_string(client_ips_.size()) + ")");
     }
@@ -126,6 +141,60 @@ size_t Heartbeat::getClientCount() const {
     return client_ips_.size();
 }
 
+LinkHealth Heartbeat::getLinkHealth() const {
+    LinkHealth health;
+    health.ever_heard = heartbeat_received_;
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(link_mutex_);
+    health.heard = health.ever_heard &&
+        now - last_received_ <= std::chrono::seconds(config::HEARTBEAT_TIMEOUT_SEC);
+    for (const auto& entry : ground_links_) {
+        health.loss = std::max(health.loss, entry.second.loss);
+    }
+    health.rtt_ms = srtt_ms_;
+    return health;
+}
+
+void Heartbeat::recordReceived(const std::string& sender_ip, const json& heartbeat_msg) {
+    // Each heartbeat moves the estimates 1/8 of the way (as RFC 6298 does for RTT)
+    constexpr double GAIN = 0.125;
+
+    int seq_id = heartbeat_msg.value("sequence_id", -1);
+    json payload = heartbeat_msg.value("payload", json::object());
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(link_mutex_);
+
+    // Loss: every sequence_id skipped counts as a lost heartbeat. A lower
+    // one means the ground restarted - count from there.
+    GroundLink& link = ground_links_[sender_ip];
+    if (seq_id >= 0 && link.last_seq >= 0 && seq_id > link.last_seq) {
+        int missed = std::min(seq_id - link.last_seq - 1, 100);
+        for (int i = 0; i < missed; ++i) {
+            link.loss += GAIN * (1.0 - link.loss);
+        }
+        link.loss -= GAIN * link.loss;
+    }
+    if (seq_id >= 0 && seq_id != link.last_seq) {
+        link.last_seq = seq_id;
+    }
+
+    // Round trip: the ground echoes the last heartbeat it had from us and
+    // how long it held it before this one went out
+    if (payload.contains("echo_sequence_id")) {
+        int echoed = payload.value("echo_sequence_id", -1);
+        double held_ms = payload.value("echo_delay_ms", 0.0);
+        if (echoed >= 0 && sent_[echoed % sent_.size()].first == echoed) {
+            double rtt_ms = std::chrono::duration<double, std::milli>(
+                now - sent_[echoed % sent_.size()].second).count() - held_ms;
+            if (rtt_ms >= 0.0) {
+                srtt_ms_ = srtt_ms_ < 0.0 ? rtt_ms : srtt_ms_ + GAIN * (rtt_ms - srtt_ms_);
+            }
+        }
+    }
+}
+
 void Heartbeat::sendLoop() {
     Logger::debug("Heartbeat send loop started");
 
@@ -134,14 +203,22 @@ void Heartbeat::sendLoop() {
     while (running_) {
         try {
             // Create heartbeat message (v1.1.0 - includes client_id)
-            int64_t uptime = SystemInfo::getStatus().uptime_seconds;
+            std::chrono::milliseconds age;
+            int64_t uptime = SystemInfo::getSnapshot(age).uptime_seconds;
+            int seq_id = sequence_id_++;
             json heartbeat_msg = messages::createHeartbeatMessage(
-                sequence_id_++,
+                seq_id,
                 "air",
                 "RPi-Air",
                 uptime
             );
 
+            // Kept to time the ground's echo of it
+            {
+                std::lock_guard<std::mutex> lock(link_mutex_);
+                sent_[seq_id % sent_.size()] = {seq_id, std::chrono::steady_clock::now()};
+            }
+
             // Send to all registered clients
             std::string message_str = heartbeat_msg.dump();
 
@@ -264,10 +341,22 @@ void Heartbeat::receiveLoop() {
                 std::string sender = heartbeat_msg["payload"].value("sender", "unknown");
                 int seq_id = heartbeat_msg.value("sequence_id", 0);
 
+                // Our own, looped back to a client on this host - not a sign of the ground
+                if (sender == "air") {
+                    continue;
+                }
+
                 Logger::debug("Received heartbeat from " + sender + " (seq=" + std::to_string(seq_id) + ")");
 
-                last_received_ = std::chrono::steady_clock::now();
+                {
+                    std::lock_guard<std::mutex> lock(link_mutex_);
+                    last_received_ = std::chrono::steady_clock::now();
+                }
                 heartbeat_received_ = true;
+
+                char sender_ip[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &sender_addr.sin_addr, sender_ip, sizeof(sender_ip));
+                recordReceived(sender_ip, heartbeat_msg);
             }
         } catch (const json::exception& e) {
             Logger::warning("Invalid heartbeat message: " + std::string(e.what()));
@@ -7,6 +7,19 @@
 #include <mutex>
 #include <chrono>
 #include <set>
+#include <map>
+#include <array>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Link quality as seen through the ground's heartbeats
+struct LinkHealth {
+    bool heard = false;       // A ground heartbeat arrived within HEARTBEAT_TIMEOUT_SEC
+    bool ever_heard = false;  // Any ground heartbeat since start - until then there is no link to judge
+    double loss = 0.0;     // Smoothed fraction of ground heartbeats missing (worst ground)
+    double rtt_ms = -1.0;  // Smoothed round trip; -1 until the ground echoes ours
+};
 
 class Heartbeat {
 public:
@@ -22,6 +35,13 @@ public:
     // Check if running
     bool isRunning() const { return running_; }
 
+    // Use a socket passed from the instance being replaced instead of
+    // binding (call before start())
+    void inheritSocket(int fd) { socket_fd_ = fd; }
+
+    // Socket to pass to a replacement (-1 if not open)
+    int socketFd() const { return socket_fd_; }
+
     // Get time since last received heartbeat (in seconds)
     double getTimeSinceLastHeartbeat() const;
 
@@ -37,6 +57,11 @@ public:
     // Get number of registered clients
     size_t getClientCount() const;
 
+    // Loss from gaps in each ground's sequence_ids; round trip from grounds
+    // that echo our latest heartbeat (payload echo_sequence_id, and
+    // echo_delay_ms = how long they held it). Thread-safe.
+    LinkHealth getLinkHealth() const;
+
 private:
     // Send heartbeat loop
     void sendLoop();
@@ -44,6 +69,15 @@ private:
     // Receive heartbeat loop
     void receiveLoop();
 
+    // Account for a ground heartbeat (receive thread)
+    void recordReceived(const std::string& sender_ip, const json& heartbeat_msg);
+
+    // Per-ground sequence tracking
+    struct GroundLink {
+        int last_seq = -1;
+        double loss = 0.0;
+    };
+
     int socket_fd_;
     int port_;
     std::set<std::string> client_ips_;  // Multiple client IPs
@@ -53,8 +87,14 @@ private:
     std::thread send_thread_;
     std::thread receive_thread_;
     int sequence_id_;
-    std::chrono::steady_clock::time_point last_received_;
+    std::chrono::steady_clock::time_point last_received_;  // link_mutex_
     std::atomic<bool> heartbeat_received_;
+
+    // Link health (link_mutex_)
+    mutable std::mutex link_mutex_;
+    std::map<std::string, GroundLink> ground_links_;  // By sender IP
+    std::array<std::pair<int, std::chrono::steady_clock::time_point>, 16> sent_;  // Recent (seq, send time)
+    double srtt_ms_ = -1.0;
 };
 
 #endif // HEARTBEAT_H
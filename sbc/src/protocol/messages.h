@@ -5,6 +5,7 @@
 #include <vector>
 #include <ctime>
 #include <nlohmann/json.hpp>
+#include "config.h"
 
 using json = nlohmann::json;
 
@@ -17,7 +18,13 @@ enum class ErrorCode {
     COMMAND_NOT_IMPLEMENTED = 5002,
     UNKNOWN_COMMAND = 5003,
     INTERNAL_ERROR = 5004,
-    COMMAND_FAILED = 5005
+    COMMAND_FAILED = 5005,
+    MISSING_REQUIRED_FIELD = 5006,
+    INVALID_PARAMETER = 5007,
+    COMMAND_EXPIRED = 5008,
+    RATE_LIMITED = 5009,
+    TOO_MANY_CLIENTS = 5010,
+    CLIENT_ID_IN_USE = 5011
 };
 
 // Notification levels
@@ -49,6 +56,18 @@ inline std::string errorCodeToString(ErrorCode code) {
             return "Internal server error";
         case ErrorCode::COMMAND_FAILED:
             return "Command execution failed";
+        case ErrorCode::MISSING_REQUIRED_FIELD:
+            return "Missing required field";
+        case ErrorCode::INVALID_PARAMETER:
+            return "Invalid parameter";
+        case ErrorCode::COMMAND_EXPIRED:
+            return "Command expired";
+        case ErrorCode::RATE_LIMITED:
+            return "Rate limited";
+        case ErrorCode::TOO_MANY_CLIENTS:
+            return "Too many clients";
+        case ErrorCode::CLIENT_ID_IN_USE:
+            return "Client ID in use";
         default:
             return "Unknown error";
     }
@@ -170,7 +189,7 @@ struct GimbalStatus {
 // Create success response
 inline json createSuccessResponse(int seq_id, const std::string& command, const json& result) {
     return {
-        {"protocol_version", "1.0"},
+        {"protocol_version", config::PROTOCOL_VERSION},
         {"message_type", "response"},
         {"sequence_id", seq_id},
         {"timestamp", std::time(nullptr)},
@@ -186,7 +205,7 @@ inline json createSuccessResponse(int seq_id, const std::string& command, const
 inline json createErrorResponse(int seq_id, const std::string& command,
                                ErrorCode error_code, const std::string& details = "") {
     return {
-        {"protocol_version", "1.0"},
+        {"protocol_version", config::PROTOCOL_VERSION},
         {"message_type", "response"},
         {"sequence_id", seq_id},
         {"timestamp", std::time(nullptr)},
@@ -202,11 +221,73 @@ inline json createErrorResponse(int seq_id, const std::string& command,
     };
 }
 
+// Create superseded response - the request was replaced by a newer one for
+// the same target before it ran, and was never executed
+inline json createSupersededResponse(int seq_id, const std::string& command, int superseded_by) {
+    return {
+        {"protocol_version", config::PROTOCOL_VERSION},
+        {"message_type", "response"},
+        {"sequence_id", seq_id},
+        {"timestamp", std::time(nullptr)},
+        {"payload", {
+            {"command", command},
+            {"status", "superseded"},
+            {"result", {
+                {"superseded_by", superseded_by}
+            }}
+        }}
+    };
+}
+
+// Create rate-limited error response (retry_after_ms tells the client when
+// the same command would be accepted)
+inline json createRateLimitedResponse(int seq_id, const std::string& command, int64_t retry_after_ms) {
+    json response = createErrorResponse(
+        seq_id, command, ErrorCode::RATE_LIMITED,
+        "Rate limited, retry after " + std::to_string(retry_after_ms) + " ms"
+    );
+    response["payload"]["error"]["retry_after_ms"] = retry_after_ms;
+    return response;
+}
+
+// Create stream header - first message of a streamed response
+// The chunks and the final response that follow carry the same sequence_id
+inline json createStreamHeader(int seq_id, const std::string& command, const json& info) {
+    return {
+        {"protocol_version", config::PROTOCOL_VERSION},
+        {"message_type", "stream"},
+        {"sequence_id", seq_id},
+        {"timestamp", std::time(nullptr)},
+        {"payload", {
+            {"command", command},
+            {"stream", "begin"},
+            {"info", info}
+        }}
+    };
+}
+
+// Create stream chunk - part of a streamed result, in order from index 0
+// data is an object (members of the result) or an array (items of it)
+inline json createStreamChunk(int seq_id, const std::string& command, int index, const json& data) {
+    return {
+        {"protocol_version", config::PROTOCOL_VERSION},
+        {"message_type", "stream"},
+        {"sequence_id", seq_id},
+        {"timestamp", std::time(nullptr)},
+        {"payload", {
+            {"command", command},
+            {"stream", "chunk"},
+            {"index", index},
+            {"data", data}
+        }}
+    };
+}
+
 // Create status broadcast message
 inline json createStatusMessage(int seq_id, const SystemStatus& system,
                                const CameraStatus& camera, const GimbalStatus& gimbal) {
     return {
-        {"protocol_version", "1.0"},
+        {"protocol_version", config::PROTOCOL_VERSION},
         {"message_type", "status"},
         {"sequence_id", seq_id},
         {"timestamp", std::time(nullptr)},
@@ -218,10 +299,47 @@ inline json createStatusMessage(int seq_id, const SystemStatus& system,
     };
 }
 
+// Create status delta message (delta status stream)
+// Sent many times a second over the radio, so it has none of the usual
+// envelope: {"status_delta": [seq_id, base_seq_id, index, value, ...]}.
+// changes holds index/value pairs - the leaves of the keyframe (the status
+// message with sequence_id base_seq_id) that differ, numbered in the order
+// they appear in its payload.
+inline json createStatusDeltaMessage(int seq_id, int base_seq_id, const json& changes) {
+    json fields = json::array({seq_id, base_seq_id});
+    fields.insert(fields.end(), changes.begin(), changes.end());
+    return {{"status_delta", std::move(fields)}};
+}
+
+// Create event message - pushed to clients that subscribed to it
+inline json createEventMessage(int seq_id, const std::string& event, const json& data) {
+    return {
+        {"protocol_version", config::PROTOCOL_VERSION},
+        {"message_type", "event"},
+        {"sequence_id", seq_id},
+        {"timestamp", std::time(nullptr)},
+        {"payload", {
+            {"event", event},
+            {"data", data}
+        }}
+    };
+}
+
+// Create acknowledgement (UDP command channel)
+// Confirms receipt of the message with this sequence_id, not its result
+inline json createAckMessage(int seq_id) {
+    return {
+        {"protocol_version", config::PROTOCOL_VERSION},
+        {"message_type", "ack"},
+        {"sequence_id", seq_id},
+        {"timestamp", std::time(nullptr)}
+    };
+}
+
 // Create heartbeat message (v1.1.0 - includes client_id)
 inline json createHeartbeatMessage(int seq_id, const std::string& sender, const std::string& client_id, int64_t uptime) {
     return {
-        {"protocol_version", "1.0"},
+        {"protocol_version", config::PROTOCOL_VERSION},
         {"message_type", "heartbeat"},
         {"sequence_id", seq_id},
         {"timestamp", std::time(nullptr)},
@@ -253,7 +371,7 @@ inline json createNotificationMessage(int seq_id, NotificationLevel level,
     }
 
     return {
-        {"protocol_version", "1.0"},
+        {"protocol_version", config::PROTOCOL_VERSION},
         {"message_type", "notification"},
         {"sequence_id", seq_id},
         {"timestamp", std::time(nullptr)},
@@ -0,0 +1,31 @@
+#include "protocol/rate_limiter.h"
+#include <algorithm>
+#include <cmath>
+
+TokenBucket::TokenBucket(double rate_per_sec, double burst)
+    : rate_per_sec_(rate_per_sec)
+    , burst_(burst)
+    , tokens_(burst)
+    , last_refill_(Clock::now()) {
+}
+
+bool TokenBucket::take(double cost, int64_t& retry_after_ms, Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    if (elapsed > 0) {
+        tokens_ = std::min(burst_, tokens_ + elapsed * rate_per_sec_);
+        last_refill_ = now;
+    }
+
+    cost = std::min(cost, burst_);
+    if (tokens_ >= cost) {
+        tokens_ -= cost;
+        return true;
+    }
+
+    retry_after_ms = static_cast<int64_t>(std::ceil((cost - tokens_) / rate_per_sec_ * 1000.0));
+    return false;
+}
+
+void TokenBucket::refund(double tokens) {
+    tokens_ = std::min(burst_, tokens_ + tokens);
+}
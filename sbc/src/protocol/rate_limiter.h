@@ -0,0 +1,47 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "config.h"
+
+// Token bucket rate limit
+// Holds up to burst tokens and refills at rate_per_sec; each admitted
+// request takes cost tokens. Not thread-safe: a bucket belongs to one
+// connection and is only used on the event loop.
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double rate_per_sec, double burst);
+
+    // Take cost tokens (capped at burst, so any request can eventually pass).
+    // If there are not enough, takes nothing and sets retry_after_ms to the
+    // time until there will be.
+    bool take(double cost, int64_t& retry_after_ms, Clock::time_point now = Clock::now());
+
+    // Give back tokens taken for a request that was never carried out
+    void refund(double tokens);
+
+private:
+    double rate_per_sec_;
+    double burst_;
+    double tokens_;
+    Clock::time_point last_refill_;
+};
+
+// A client's command budget: one bucket per dispatcher lane
+// Superseded commands are found out on a worker, so their tokens come back
+// through refunds (shared - it may outlive the client) and are settled on
+// the budget's own thread at the next charge.
+struct CommandBudget {
+    using Refunds = std::shared_ptr<std::atomic<int>>;
+
+    TokenBucket camera{config::RATE_LIMIT_CAMERA_PER_SEC, config::RATE_LIMIT_CAMERA_BURST};
+    TokenBucket general{config::RATE_LIMIT_GENERAL_PER_SEC, config::RATE_LIMIT_GENERAL_BURST};
+    Refunds camera_refunds = std::make_shared<std::atomic<int>>(0);
+};
+
+#endif // RATE_LIMITER_H
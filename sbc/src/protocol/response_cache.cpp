@@ -0,0 +1,106 @@
+#include "protocol/response_cache.h"
+
+ResponseCache::ResponseCache(size_t max_entries, size_t max_bytes, std::chrono::seconds max_age)
+    : max_entries_(max_entries)
+    , max_bytes_(max_bytes)
+    , max_age_(max_age) {
+}
+
+std::string ResponseCache::makeKey(const std::string& scope, int seq_id) {
+    return scope + '\x1f' + std::to_string(seq_id);
+}
+
+uint64_t ResponseCache::fingerprint(const std::string& payload_dump) {
+    return std::hash<std::string>{}(payload_dump);
+}
+
+ResponseCache::Lookup ResponseCache::lookup(const std::string& scope, int seq_id, uint64_t fingerprint,
+                                            std::string& frame, wire::Encoding& encoding, Waiter waiter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    std::string key = makeKey(scope, seq_id);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        Entry& entry = *it->second;
+        bool expired = entry.done && now - entry.stored > max_age_;
+
+        if (entry.fingerprint == fingerprint && !expired) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+            if (!entry.done) {
+                entry.waiters.push_back(std::move(waiter));
+                return Lookup::PENDING;
+            }
+            frame = entry.frame;
+            encoding = entry.encoding;
+            return Lookup::HIT;
+        }
+
+        // A different request reusing the sequence_id (or a stale answer).
+        // While the original runs it keeps the slot; the newcomer runs uncached.
+        if (!entry.done) {
+            return Lookup::MISS;
+        }
+        bytes_ -= entry.frame.size();
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.fingerprint = fingerprint;
+    entries_.push_front(std::move(entry));
+    index_[key] = entries_.begin();
+
+    evict(now);
+    return Lookup::MISS;
+}
+
+void ResponseCache::complete(const std::string& scope, int seq_id, uint64_t fingerprint,
+                             const std::string& frame, wire::Encoding encoding, bool store) {
+    std::vector<Waiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(makeKey(scope, seq_id));
+        if (it == index_.end() || it->second->fingerprint != fingerprint || it->second->done) {
+            return;  // Ran uncached (its sequence_id was taken)
+        }
+
+        Entry& entry = *it->second;
+        waiters.swap(entry.waiters);
+        if (store) {
+            entry.done = true;
+            entry.frame = frame;
+            entry.encoding = encoding;
+            entry.stored = Clock::now();
+            bytes_ += frame.size();
+            evict(entry.stored);
+        } else {
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+    }
+
+    for (auto& waiter : waiters) {
+        waiter(frame, encoding);
+    }
+}
+
+void ResponseCache::evict(Clock::time_point now) {
+    // From the least recently used end; stops at the first entry that is
+    // neither expired nor over the bounds (lookup() checks age as well)
+    for (auto it = entries_.end(); it != entries_.begin();) {
+        --it;
+        bool over = entries_.size() > max_entries_ || bytes_ > max_bytes_;
+        bool expired = it->done && now - it->stored > max_age_;
+        if (!over && !expired) {
+            break;
+        }
+        if (!it->done) {
+            continue;
+        }
+        bytes_ -= it->frame.size();
+        index_.erase(it->key);
+        it = entries_.erase(it);
+    }
+}
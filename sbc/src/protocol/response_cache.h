@@ -0,0 +1,80 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "protocol/wire_format.h"
+
+// Recent successful responses by (scope, sequence_id), for safe retries
+// A ground station that times out resends the same command with the same
+// sequence_id - possibly on a new connection. The retry is answered with
+// the original response instead of running the handler again (firing the
+// shutter twice). A retry that arrives while the original is still running
+// gets the original's response when it completes.
+// The scope is one session instance (see Session::cache_scope), so a
+// relaunched client or another one using the same client_id starts empty.
+// A request is matched on its command and parameters too (fingerprint), so
+// a client that restarts its sequence_ids is not served stale answers.
+// Bounded by entry count and bytes (least recently used go first) and by
+// age. Thread-safe.
+class ResponseCache {
+public:
+    // Receives the original's response frame and the encoding it is in
+    using Waiter = std::function<void(const std::string& frame, wire::Encoding encoding)>;
+
+    enum class Lookup {
+        MISS,     // New request - run it, then call complete()
+        HIT,      // Answered before - frame/encoding hold the response
+        PENDING   // Original still running - waiter will get its response
+    };
+
+    ResponseCache(size_t max_entries, size_t max_bytes, std::chrono::seconds max_age);
+
+    Lookup lookup(const std::string& scope, int seq_id, uint64_t fingerprint,
+                  std::string& frame, wire::Encoding& encoding, Waiter waiter);
+
+    // Record the response to a request lookup() returned MISS for, and pass
+    // it to any retries waiting on it. With store false the retries get it
+    // but the entry is dropped - the next resend runs afresh.
+    void complete(const std::string& scope, int seq_id, uint64_t fingerprint,
+                  const std::string& frame, wire::Encoding encoding, bool store = true);
+
+    // Fingerprint of a command payload (command name and parameters)
+    static uint64_t fingerprint(const std::string& payload_dump);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string key;
+        uint64_t fingerprint = 0;
+        bool done = false;
+        std::string frame;
+        wire::Encoding encoding = wire::Encoding::JSON;
+        Clock::time_point stored;
+        std::vector<Waiter> waiters;
+    };
+
+    // Drop expired entries, then least recently used ones over the bounds
+    // (never one still running - its retries are waiting on it)
+    void evict(Clock::time_point now);
+
+    static std::string makeKey(const std::string& scope, int seq_id);
+
+    size_t max_entries_;
+    size_t max_bytes_;
+    std::chrono::seconds max_age_;
+
+    std::mutex mutex_;
+    std::list<Entry> entries_;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t bytes_ = 0;
+};
+
+#endif // RESPONSE_CACHE_H
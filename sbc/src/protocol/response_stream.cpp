@@ -0,0 +1,195 @@
+#include "protocol/response_stream.h"
+#include "config.h"
+#include "protocol/messages.h"
+
+bool StreamWindow::reserve(size_t bytes, size_t limit, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool ready = drained_.wait_for(lock, timeout, [this, bytes, limit] {
+        size_t outstanding = in_transit_ + queued_;
+        return closed_ || outstanding == 0 || outstanding + bytes <= limit;
+    });
+    if (!ready || closed_) {
+        return false;
+    }
+    in_transit_ += bytes;
+    return true;
+}
+
+void StreamWindow::arrived(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_transit_ -= bytes;
+}
+
+void StreamWindow::update(size_t queued) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_ = queued;
+    }
+    drained_.notify_all();
+}
+
+bool StreamWindow::closed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+}
+
+void StreamWindow::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    drained_.notify_all();
+}
+
+ResponseStream::ResponseStream(int seq_id, std::string command, wire::Encoding encoding,
+                               std::shared_ptr<StreamWindow> window, Send send)
+    : seq_id_(seq_id)
+    , command_(std::move(command))
+    , encoding_(encoding)
+    , window_(std::move(window))
+    , send_(std::move(send)) {
+}
+
+bool ResponseStream::begin(const json& info) {
+    return send(wire::encode(messages::createStreamHeader(seq_id_, command_, info), encoding_));
+}
+
+void ResponseStream::open(bool array) {
+    if (chunk_items_ == 0) {
+        array_ = array;
+        if (wire::isBinary(encoding_)) {
+            data_ = array ? json::array() : json::object();
+            data_bytes_ = 0;
+        } else {
+            // createStreamChunk()'s message, cut open at its data so members
+            // can be appended as they arrive
+            constexpr size_t null_size = sizeof("null") - 1;
+            std::string chunk = messages::createStreamChunk(seq_id_, command_, chunks_, nullptr).dump();
+            size_t data = chunk.find("\"data\":null") + sizeof("\"data\":") - 1;
+            frame_.clear();
+            frame_.reserve(config::STREAM_CHUNK_BYTES + 1024);
+            frame_.append(chunk, 0, data);
+            frame_ += array ? '[' : '{';
+            frame_tail_.assign(chunk, data + null_size, std::string::npos);
+        }
+    } else if (!wire::isBinary(encoding_)) {
+        frame_ += ',';
+    }
+}
+
+bool ResponseStream::add(const std::string& key, const json& value) {
+    if (cancelled_) {
+        return false;
+    }
+
+    open(false);
+    if (wire::isBinary(encoding_)) {
+        data_bytes_ += key.size() + value.dump().size();
+        data_[key] = value;
+    } else {
+        frame_ += json(key).dump();
+        frame_ += ':';
+        frame_ += value.dump();
+    }
+    ++chunk_items_;
+    ++items_;
+
+    size_t size = wire::isBinary(encoding_) ? data_bytes_ : frame_.size();
+    return size < config::STREAM_CHUNK_BYTES || flush();
+}
+
+bool ResponseStream::add(const json& item) {
+    if (cancelled_) {
+        return false;
+    }
+
+    open(true);
+    if (wire::isBinary(encoding_)) {
+        data_bytes_ += item.dump().size();
+        data_.push_back(item);
+    } else {
+        frame_ += item.dump();
+    }
+    ++chunk_items_;
+    ++items_;
+
+    size_t size = wire::isBinary(encoding_) ? data_bytes_ : frame_.size();
+    return size < config::STREAM_CHUNK_BYTES || flush();
+}
+
+bool ResponseStream::flush() {
+    if (chunk_items_ == 0) {
+        return !cancelled_;
+    }
+
+    std::string frame;
+    if (wire::isBinary(encoding_)) {
+        frame = wire::encode(messages::createStreamChunk(seq_id_, command_, chunks_, data_), encoding_);
+        data_ = json();
+    } else {
+        frame_ += array_ ? ']' : '}';
+        frame_ += frame_tail_;
+        frame_ += '\n';
+        frame.swap(frame_);
+    }
+    chunk_items_ = 0;
+    ++chunks_;
+    return send(std::move(frame));
+}
+
+bool ResponseStream::send(std::string frame) {
+    if (cancelled_) {
+        return false;
+    }
+
+    if (defer_waits_) {
+        // Once one frame is kept, the rest queue behind it
+        if (kept_.empty() && window_->reserve(frame.size(), config::STREAM_WINDOW_BYTES,
+                                              std::chrono::milliseconds(0))) {
+            send_(std::move(frame));
+        } else if (window_->closed()) {
+            cancelled_ = true;
+        } else {
+            kept_.push_back(std::move(frame));
+        }
+        return !cancelled_;
+    }
+
+    if (!window_->reserve(frame.size(), config::STREAM_WINDOW_BYTES,
+                          std::chrono::milliseconds(config::STREAM_STALL_TIMEOUT_MS))) {
+        cancelled_ = true;
+        return false;
+    }
+    send_(std::move(frame));
+    return true;
+}
+
+bool ResponseStream::drain() {
+    defer_waits_ = false;
+    while (!kept_.empty() && !cancelled_) {
+        std::string frame = std::move(kept_.front());
+        kept_.pop_front();
+        send(std::move(frame));
+    }
+    kept_.clear();
+    return !cancelled_;
+}
+
+json ResponseStream::finish(json result) {
+    if (drain()) {
+        flush();
+    }
+
+    if (cancelled_) {
+        return messages::createErrorResponse(
+            seq_id_, command_, messages::ErrorCode::COMMAND_FAILED,
+            "Stream cut short after " + std::to_string(chunks_) + " chunks - client gone or not reading"
+        );
+    }
+
+    result["stream"] = {
+        {"chunks", chunks_},
+        {"items", items_}
+    };
+    return messages::createSuccessResponse(seq_id_, command_, result);
+}
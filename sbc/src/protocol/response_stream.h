@@ -0,0 +1,113 @@
+#ifndef RESPONSE_STREAM_H
+#define RESPONSE_STREAM_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "protocol/wire_format.h"
+
+using json = nlohmann::json;
+
+// Flow control between a connection's streams and its socket
+// Workers producing a stream wait here while the client has too much
+// unsent; the event loop reports what is still queued after each write.
+class StreamWindow {
+public:
+    // Worker: wait until bytes more may be handed to the loop (always
+    // allowed when nothing is outstanding). Returns false if the connection
+    // closed or nothing drained within timeout.
+    bool reserve(size_t bytes, size_t limit, std::chrono::milliseconds timeout);
+
+    // Event loop: a reserved frame was queued (or dropped)
+    void arrived(size_t bytes);
+
+    // Event loop: bytes still unsent on the connection
+    void update(size_t queued);
+
+    // Event loop: the connection is gone - waiting workers give up
+    void close();
+
+    bool closed();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable drained_;
+    size_t in_transit_ = 0;  // Reserved, not yet queued by the loop
+    size_t queued_ = 0;      // Unsent on the connection, as last reported
+    bool closed_ = false;
+};
+
+// A command result sent to one client in parts
+//   stream "begin" (header) -> stream "chunk" x N -> the usual response
+// Members (or items) are serialized into the chunk frame as they are added
+// and the frame is handed to the connection once it reaches
+// STREAM_CHUNK_BYTES, so the result is never built as a whole and the
+// client starts receiving it at once. A producer that must not wait (the
+// camera lane) defers its waits: chunks the window has no room for are kept
+// as frames until drain(), which a general worker runs.
+class ResponseStream {
+public:
+    using Send = std::function<void(std::string frame)>;
+
+    // send hands a complete frame to the connection (reserved in window)
+    ResponseStream(int seq_id, std::string command, wire::Encoding encoding,
+                   std::shared_ptr<StreamWindow> window, Send send);
+
+    ResponseStream(const ResponseStream&) = delete;
+    ResponseStream& operator=(const ResponseStream&) = delete;
+
+    // Send the header; info describes what follows (e.g. a total)
+    bool begin(const json& info = json::object());
+
+    // Add a member of an object result, or an item of an array result (one
+    // kind per stream). Returns false once the client is gone or stalled -
+    // stop producing and return finish().
+    bool add(const std::string& key, const json& value);
+    bool add(const json& item);
+
+    bool cancelled() const { return cancelled_; }
+
+    // From now on keep frames the window has no room for instead of waiting
+    void deferWaits() { defer_waits_ = true; }
+
+    // Send the kept frames, waiting for the window; stops deferring
+    bool drain();
+
+    // Flush the last chunk and build the final response: result plus
+    // "stream": {chunks, items}, or an error if the stream was cut short
+    json finish(json result = json::object());
+
+private:
+    // Start a chunk if none is open, else separate the next member
+    void open(bool array);
+    bool flush();
+    bool send(std::string frame);
+
+    int seq_id_;
+    std::string command_;
+    wire::Encoding encoding_;
+    std::shared_ptr<StreamWindow> window_;
+    Send send_;
+
+    std::string frame_;       // JSON: chunk frame being written
+    std::string frame_tail_;  // JSON: what follows the chunk data in the frame
+    json data_;               // Binary encodings: chunk data, encoded on flush
+    size_t data_bytes_ = 0;   // Approximate size of data_
+    size_t chunk_items_ = 0;
+    bool array_ = false;
+
+    int chunks_ = 0;
+    size_t items_ = 0;
+    bool cancelled_ = false;
+
+    bool defer_waits_ = false;
+    std::deque<std::string> kept_;  // Frames waiting for the window, in order
+};
+
+#endif // RESPONSE_STREAM_H
@@ -0,0 +1,65 @@
+#ifndef SERVER_STATS_H
+#define SERVER_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Counters maintained by the command server
+// Updated from the event loop and worker threads, so every field is atomic.
+struct ServerStats {
+    // Connections
+    std::atomic<uint64_t> local_peers_rejected{0};  // Unix socket peers failing the credential check
+    std::atomic<uint64_t> clients_refused{0};       // TCP connections over MAX_TCP_CLIENTS
+
+    // Inbound framing
+    std::atomic<uint64_t> frames_received{0};
+    std::atomic<uint64_t> frames_oversize{0};
+    std::atomic<uint64_t> frames_garbage{0};
+
+    // Command execution
+    std::atomic<uint64_t> commands_dispatched{0};
+    std::atomic<uint64_t> in_flight_limited{0};   // Times a connection hit TCP_MAX_IN_FLIGHT
+    std::atomic<uint64_t> commands_expired{0};    // Dropped as stale (deadline_ms / max_age_ms)
+    std::atomic<uint64_t> commands_superseded{0}; // Replaced by a newer request before running
+    std::atomic<uint64_t> commands_rate_limited{0};        // Refused by a client's token bucket
+    std::atomic<uint64_t> camera_commands_rate_limited{0}; // ...of which camera commands
+    std::atomic<uint64_t> retries_from_cache{0};    // Resent commands answered from the response cache
+    std::atomic<uint64_t> retries_joined{0};        // Resent while the original was still running
+
+    // Outbound
+    std::atomic<uint64_t> messages_sent{0};
+    std::atomic<uint64_t> send_calls{0};          // sendmsg() calls - messages_sent/send_calls = batching
+    std::atomic<uint64_t> messages_dropped{0};    // Notifications dropped for a full queue
+    std::atomic<uint64_t> slow_client_disconnects{0};
+    std::atomic<uint64_t> responses_streamed{0};
+    std::atomic<uint64_t> stream_chunks_sent{0};  // Headers and chunks (not final responses)
+
+    json toJson() const {
+        return {
+            {"local_peers_rejected", local_peers_rejected.load()},
+            {"clients_refused", clients_refused.load()},
+            {"frames_received", frames_received.load()},
+            {"frames_oversize", frames_oversize.load()},
+            {"frames_garbage", frames_garbage.load()},
+            {"commands_dispatched", commands_dispatched.load()},
+            {"in_flight_limited", in_flight_limited.load()},
+            {"commands_expired", commands_expired.load()},
+            {"commands_superseded", commands_superseded.load()},
+            {"commands_rate_limited", commands_rate_limited.load()},
+            {"camera_commands_rate_limited", camera_commands_rate_limited.load()},
+            {"retries_from_cache", retries_from_cache.load()},
+            {"retries_joined", retries_joined.load()},
+            {"messages_sent", messages_sent.load()},
+            {"send_calls", send_calls.load()},
+            {"messages_dropped", messages_dropped.load()},
+            {"slow_client_disconnects", slow_client_disconnects.load()},
+            {"responses_streamed", responses_streamed.load()},
+            {"stream_chunks_sent", stream_chunks_sent.load()}
+        };
+    }
+};
+
+#endif // SERVER_STATS_H
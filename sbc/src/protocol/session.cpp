@@ -0,0 +1,18 @@
+#include "protocol/session.h"
+
+void Session::record(int seq_id, std::shared_ptr<const json> message, size_t capacity) {
+    backlog.emplace_back(seq_id, std::move(message));
+    while (backlog.size() > capacity) {
+        dropped_through = backlog.front().first;
+        backlog.pop_front();
+    }
+}
+
+bool Session::replayAfter(int last_seen, std::vector<std::shared_ptr<const json>>& messages) const {
+    for (const auto& entry : backlog) {
+        if (entry.first > last_seen) {
+            messages.push_back(entry.second);
+        }
+    }
+    return last_seen >= dropped_through;
+}
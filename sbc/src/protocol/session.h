@@ -0,0 +1,51 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Camera property subscription (camera.subscribe)
+struct PropertySubscription {
+    std::unordered_set<std::string> properties;
+    std::chrono::milliseconds interval{0};
+    std::chrono::steady_clock::time_point last_event;
+    json pending_changes = json::object();  // Held back by interval, or while detached
+};
+
+// A ground station's session, identified by the client_id from its handshake
+// Outlives the connection: while the client is away (e.g. a radio dropout)
+// notifications still go into its backlog and property changes it subscribed
+// to are merged, so a reconnecting client can resume where it left off
+// instead of re-reading everything. Event loop thread only.
+struct Session {
+    std::string client_id;
+    std::string cache_scope;        // Server-issued when the session (re)starts - keys the response cache
+    int fd = -1;                    // Attached connection, -1 while detached
+    uint64_t connection_id = 0;
+    std::chrono::steady_clock::time_point detached_at;
+    PropertySubscription subscription;  // Parked here while detached
+
+    // Last events and notifications, oldest first, by event sequence number
+    std::deque<std::pair<int, std::shared_ptr<const json>>> backlog;
+    int dropped_through = -1;       // Newest sequence number that fell out of the ring
+
+    bool attached() const { return fd >= 0; }
+
+    // Add a message, dropping the oldest beyond capacity
+    void record(int seq_id, std::shared_ptr<const json> message, size_t capacity);
+
+    // Messages after last_seen, oldest first. Returns false if some were
+    // already dropped (the client must resync with full reads).
+    bool replayAfter(int last_seen, std::vector<std::shared_ptr<const json>>& messages) const;
+};
+
+#endif // SESSION_H
@@ -0,0 +1,347 @@
+#include "protocol/socket_handoff.h"
+#include "config.h"
+#include "utils/logger.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstring>
+#include <errno.h>
+#include <chrono>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+// More than we will ever offer (TCP, local, UDP command, heartbeat)
+constexpr size_t MAX_HANDOFF_FDS = 16;
+
+bool makeAddress(const std::string& path, struct sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) {
+        Logger::warning("Handoff socket path too long: " + path);
+        return false;
+    }
+    addr = {};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Read one newline-terminated message, waiting up to timeout (and giving
+// up early once keep_waiting returns false). Returns false on EOF/timeout.
+bool readLine(int fd, std::string& line, std::chrono::seconds timeout,
+              const std::function<bool()>& keep_waiting) {
+    auto give_up = std::chrono::steady_clock::now() + timeout;
+    line.clear();
+    while (line.find('\n') == std::string::npos) {
+        if (std::chrono::steady_clock::now() >= give_up || !keep_waiting()) {
+            return false;
+        }
+        struct pollfd pfd{fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, 500);
+        if (ready < 0 && errno != EINTR) {
+            return false;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        char buffer[512];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return false;
+        }
+        line.append(buffer, static_cast<size_t>(n));
+    }
+    line.resize(line.find('\n'));
+    return true;
+}
+
+} // namespace
+
+SocketHandoff::SocketHandoff(const std::string& path)
+    : path_(path) {
+}
+
+SocketHandoff::~SocketHandoff() {
+    stop();
+    for (auto& entry : inherited_) {
+        close(entry.second);
+    }
+    if (channel_fd_ >= 0) {
+        close(channel_fd_);
+    }
+}
+
+bool SocketHandoff::takeOver() {
+    struct sockaddr_un addr;
+    if (path_.empty() || !makeAddress(path_, addr)) {
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        Logger::error("Failed to create handoff socket: " + std::string(strerror(errno)));
+        return false;
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        Logger::warning("No running instance on " + path_ + " (" + std::string(strerror(errno)) + ")");
+        close(fd);
+        return false;
+    }
+
+    Logger::info("Connected to running instance - waiting for its sockets...");
+
+    // The old instance releases the camera first, which can take a while
+    struct timeval tv{};
+    tv.tv_sec = config::HANDOFF_SOCKETS_TIMEOUT_SEC;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // The descriptors ride on the first byte of the message
+    char data[4096];
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS)];
+    struct iovec iov{data, sizeof(data)};
+    struct msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    std::vector<int> fds;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int* received = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+            fds.insert(fds.end(), received, received + count);
+        }
+    }
+
+    std::string line(data, n > 0 ? static_cast<size_t>(n) : 0);
+    if (n > 0 && line.find('\n') == std::string::npos) {
+        std::string rest;
+        if (readLine(fd, rest, std::chrono::seconds(config::HANDOFF_SOCKETS_TIMEOUT_SEC), [] { return true; })) {
+            line += rest + "\n";
+        }
+    }
+
+    std::vector<std::string> names;
+    try {
+        json message = json::parse(line.substr(0, line.find('\n')));
+        names = message.at("sockets").get<std::vector<std::string>>();
+    } catch (const std::exception& e) {
+        Logger::error("Handoff failed (" + std::string(n <= 0 ? strerror(errno) : e.what()) + ") - starting normally");
+        names.clear();
+    }
+
+    if (names.empty() || names.size() != fds.size() || (msg.msg_flags & MSG_CTRUNC)) {
+        for (int received : fds) {
+            close(received);
+        }
+        if (!names.empty()) {
+            Logger::error("Handoff failed: " + std::to_string(fds.size()) + " sockets for " +
+                          std::to_string(names.size()) + " names - starting normally");
+        }
+        close(fd);
+        return false;
+    }
+
+    for (size_t i = 0; i < names.size(); ++i) {
+        inherited_[names[i]] = fds[i];
+        Logger::info("Inherited " + names[i] + " socket");
+    }
+    channel_fd_ = fd;
+    return true;
+}
+
+int SocketHandoff::take(const std::string& name) {
+    auto it = inherited_.find(name);
+    if (it == inherited_.end()) {
+        return -1;
+    }
+    int fd = it->second;
+    inherited_.erase(it);
+    return fd;
+}
+
+void SocketHandoff::ready() {
+    for (auto& entry : inherited_) {
+        Logger::info("Closing unused inherited " + entry.first + " socket");
+        close(entry.second);
+    }
+    inherited_.clear();
+
+    if (channel_fd_ < 0) {
+        return;
+    }
+
+    std::string message = json{{"ready", true}}.dump() + "\n";
+    if (send(channel_fd_, message.data(), message.size(), MSG_NOSIGNAL) < 0) {
+        Logger::warning("Failed to tell the old instance we are ready: " + std::string(strerror(errno)));
+    } else {
+        Logger::info("Told the old instance we are ready - it will shut down");
+    }
+    close(channel_fd_);
+    channel_fd_ = -1;
+}
+
+void SocketHandoff::offer(const std::string& name, int fd) {
+    if (fd >= 0) {
+        offered_.emplace_back(name, fd);
+    }
+}
+
+void SocketHandoff::start(std::function<void()> on_handoff, std::function<void()> on_ready,
+                          std::function<void()> on_abort) {
+    if (running_) {
+        Logger::warning("Socket handoff already running");
+        return;
+    }
+
+    struct sockaddr_un addr;
+    if (path_.empty() || !makeAddress(path_, addr)) {
+        return;
+    }
+
+    size_t slash = path_.find_last_of('/');
+    if (slash != std::string::npos && slash > 0) {
+        mkdir(path_.substr(0, slash).c_str(), 0755);  // EEXIST is fine
+    }
+
+    // Left by a previous run, or by the instance we just replaced
+    unlink(path_.c_str());
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 ||
+        bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd_, 1) < 0) {
+        Logger::warning("Failed to listen on " + path_ + ": " + std::string(strerror(errno)) +
+                        " - hot upgrade unavailable");
+        if (listen_fd_ >= 0) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+        }
+        return;
+    }
+    chmod(path_.c_str(), 0600);
+
+    on_handoff_ = std::move(on_handoff);
+    on_ready_ = std::move(on_ready);
+    on_abort_ = std::move(on_abort);
+    running_ = true;
+    thread_ = std::thread(&SocketHandoff::serveLoop, this);
+
+    Logger::info("Hot upgrade socket listening on " + path_);
+}
+
+void SocketHandoff::stop() {
+    if (!running_ && !thread_.joinable()) {
+        return;
+    }
+
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    // After a handoff the path is the replacement's
+    if (!handed_off_) {
+        unlink(path_.c_str());
+    }
+}
+
+void SocketHandoff::serveLoop() {
+    while (running_) {
+        struct pollfd pfd{listen_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, 500) <= 0) {
+            continue;
+        }
+
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+
+        // Our sockets go only to a process we would trust with them anyway
+        struct ucred cred{};
+        socklen_t cred_len = sizeof(cred);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0 ||
+            (cred.uid != 0 && cred.uid != geteuid())) {
+            Logger::warning("Rejected handoff request from pid " + std::to_string(cred.pid) +
+                            " (uid " + std::to_string(cred.uid) + ")");
+            close(fd);
+            continue;
+        }
+
+        Logger::info("Replacement instance (pid " + std::to_string(cred.pid) + ") is taking over");
+        bool done = handOff(fd);
+        close(fd);
+
+        if (done) {
+            handed_off_ = true;
+            Logger::info("Replacement instance is serving - handing over");
+            if (on_ready_) {
+                on_ready_();
+            }
+            return;
+        }
+
+        Logger::warning("Replacement instance went away before it was ready - carrying on");
+        if (on_abort_) {
+            on_abort_();
+        }
+    }
+}
+
+bool SocketHandoff::handOff(int fd) {
+    if (on_handoff_) {
+        on_handoff_();
+    }
+
+    json names = json::array();
+    std::vector<int> fds;
+    for (const auto& entry : offered_) {
+        names.push_back(entry.first);
+        fds.push_back(entry.second);
+    }
+    std::string message = json{{"sockets", names}}.dump() + "\n";
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS)] = {};
+    struct iovec iov{message.data(), message.size()};
+    struct msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (!fds.empty() && fds.size() <= MAX_HANDOFF_FDS) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+        Logger::error("Failed to send sockets to the replacement: " + std::string(strerror(errno)));
+        return false;
+    }
+    Logger::info("Sent " + std::to_string(fds.size()) + " sockets - serving until the replacement is ready");
+
+    // Keep serving while it starts up (camera connect and all)
+    std::string line;
+    if (!readLine(fd, line, std::chrono::seconds(config::HANDOFF_READY_TIMEOUT_SEC),
+                  [this] { return running_.load(); })) {
+        return false;
+    }
+
+    try {
+        return json::parse(line).value("ready", false);
+    } catch (const std::exception&) {
+        return false;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef SOCKET_HANDOFF_H
+#define SOCKET_HANDOFF_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <vector>
+#include <utility>
+
+// Hot upgrade: hand the listening and UDP sockets to a replacement process
+// The running instance listens on a Unix socket. A newly started build
+// connects to it (takeOver()), receives the sockets by name as SCM_RIGHTS
+// ancillary data and has its components use them instead of binding -
+// the kernel keeps queueing connections and datagrams throughout, so the
+// ground never sees a refused connection or a silent port.
+//
+//   new                              old
+//   connect ---------------------->  onHandoff() (e.g. release the camera)
+//           <----------------------  {"sockets": [names]} + fds
+//   start components, serving
+//   ready() ---------------------->  onReady() (shut down)
+//
+// If the new process goes away before ready(), the old one calls onAbort()
+// and keeps serving. Peers must run as root or as our user (SO_PEERCRED).
+class SocketHandoff {
+public:
+    explicit SocketHandoff(const std::string& path);
+    ~SocketHandoff();
+
+    // --- Replacement side ---
+
+    // Take the sockets of the instance listening on path. Returns false
+    // (nothing taken) if there is none or it does not answer in time.
+    bool takeOver();
+
+    // Whether takeOver() succeeded
+    bool tookOver() const { return channel_fd_ >= 0; }
+
+    // Claim a socket by name; -1 if it was not passed. The caller owns it.
+    int take(const std::string& name);
+
+    // Tell the old instance we are serving. Sockets nobody claimed are closed.
+    void ready();
+
+    // --- Running side ---
+
+    // Offer a socket to a replacement (before start(); negative fds are skipped)
+    void offer(const std::string& name, int fd);
+
+    // Listen for a replacement. Callbacks run on the handoff thread:
+    // on_handoff before the sockets are sent, then on_ready or on_abort.
+    void start(std::function<void()> on_handoff, std::function<void()> on_ready,
+               std::function<void()> on_abort);
+
+    // Stop listening
+    void stop();
+
+    bool isRunning() const { return running_; }
+
+private:
+    // Listen loop (handoff thread)
+    void serveLoop();
+
+    // Hand the offered sockets to one connected replacement
+    // Returns true once it reported ready
+    bool handOff(int fd);
+
+    std::string path_;
+
+    // Replacement side
+    int channel_fd_ = -1;                  // Connection to the old instance until ready()
+    std::map<std::string, int> inherited_;
+
+    // Running side
+    std::vector<std::pair<std::string, int>> offered_;
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> handed_off_{false};  // Path now belongs to the replacement
+    std::thread thread_;
+    std::function<void()> on_handoff_;
+    std::function<void()> on_ready_;
+    std::function<void()> on_abort_;
+};
+
+#endif // SOCKET_HANDOFF_H
@@ -1,12 +1,22 @@
 #include "protocol/tcp_server.h"
 #include "config.h"
 #include "protocol/messages.h"
+#include "protocol/command_schema.h"
 #include "protocol/udp_broadcaster.h"
 #include "protocol/heartbeat.h"
+#include "protocol/wire_format.h"
+#include "camera/camera_access.h"
 #include "utils/logger.h"
 #include "utils/system_info.h"
-#include "camera/camera_interface.h"
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <pwd.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -18,11 +28,41 @@
 
 TCPServer::TCPServer(int port)
     : server_socket_(-1)
+    , epoll_fd_(-1)
+    , wake_fd_(-1)
     , port_(port)
     , running_(false)
+    , dispatcher_(config::COMMAND_WORKER_THREADS)
+    , coalescer_(std::chrono::milliseconds(config::COMMAND_COALESCE_WINDOW_MS))
+    , response_cache_(config::RESPONSE_CACHE_MAX_ENTRIES, config::RESPONSE_CACHE_MAX_BYTES,
+                      std::chrono::seconds(config::RESPONSE_CACHE_MAX_AGE_SEC))
+    , next_connection_id_(1)
     , udp_broadcaster_(nullptr)
     , heartbeat_(nullptr)
 {
+    // Built-in commands; camera/gimbal families are registered by main()
+    static_assert(schema::isImplemented("system.get_status"), "system.get_status missing from commands.json");
+    registry_.add({
+        "handshake", {}, FLAG_IDEMPOTENT,
+        [this](const json& payload, int seq_id) { return handleHandshake(payload, seq_id); }
+    });
+
+    registry_.add({
+        "system.get_status", {}, FLAG_IDEMPOTENT,
+        [this](const json& payload, int seq_id) { return handleSystemGetStatus(payload, seq_id); }
+    });
+
+    static_assert(schema::isImplemented("system.get_metrics"), "system.get_metrics missing from commands.json");
+    registry_.add({
+        "system.get_metrics", {}, FLAG_IDEMPOTENT,
+        [this](const json& payload, int seq_id) { return handleSystemGetMetrics(payload, seq_id); }
+    });
+
+    static_assert(schema::isImplemented("system.request_keyframe"), "system.request_keyframe missing from commands.json");
+    registry_.add({
+        "system.request_keyframe", {}, FLAG_IDEMPOTENT,
+        [this](const json& payload, int seq_id) { return handleSystemRequestKeyframe(payload, seq_id); }
+    });
 }
 
 TCPServer::~TCPServer() {
@@ -35,8 +75,66 @@ void TCPServer::start() {
         return;
     }
 
-    // Create socket
-    server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+    // The command table is complete by now
+    for (const auto& name : registry_.names()) {
+        if (!metrics_.count(name)) {
+            metrics_[name] = std::make_unique<CommandMetrics>();
+        }
+    }
+
+    // Capabilities are whatever has been registered
+    handshake_result_ = {
+        {"server_id", config::SERVER_ID},
+        {"server_version", config::SERVER_VERSION},
+        {"capabilities", registry_.names()},
+        {"encodings", wire::supportedEncodings()}
+    };
+
+    // A replacement process starts on the listeners of the one it replaces
+    if (server_socket_ < 0) {
+        openTcpSocket();
+    } else {
+        Logger::info("Using inherited TCP listener");
+    }
+
+    // Create epoll instance and wakeup eventfd
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        Logger::error("Failed to create event loop: " + std::string(strerror(errno)));
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+        if (wake_fd_ >= 0) close(wake_fd_);
+        close(server_socket_);
+        epoll_fd_ = wake_fd_ = server_socket_ = -1;
+        throw std::runtime_error("Failed to create event loop");
+    }
+
+    struct epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = server_socket_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, server_socket_, &ev);
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    running_ = true;
+    Logger::info("TCP server listening on port " + std::to_string(port_));
+
+    if (local_socket_ >= 0) {
+        ev.data.fd = local_socket_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, local_socket_, &ev);
+        Logger::info("Using inherited local command socket " + local_path_);
+    } else if (!local_path_.empty()) {
+        openLocalSocket();
+    }
+
+    // Start command workers, then the event loop thread
+    dispatcher_.start();
+    loop_thread_ = std::thread(&TCPServer::eventLoop, this);
+}
+
+void TCPServer::openTcpSocket() {
+    // Create non-blocking socket (the event loop never blocks in accept)
+    server_socket_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (server_socket_ < 0) {
         Logger::error("Failed to create TCP socket: " + std::string(strerror(errno)));
         throw std::runtime_error("Failed to create socket");
@@ -61,22 +159,53 @@ void TCPServer::start() {
 
     if (bind(server_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
         close(server_socket_);
+        server_socket_ = -1;
         Logger::error("Failed to bind to port " + std::to_string(port_) + ": " + std::string(strerror(errno)));
         throw std::runtime_error("Failed to bind socket");
     }
 
     // Listen for connections
-    if (listen(server_socket_, config::MAX_TCP_CLIENTS) < 0) {
+    if (listen(server_socket_, config::TCP_LISTEN_BACKLOG) < 0) {
         close(server_socket_);
+        server_socket_ = -1;
         Logger::error("Failed to listen on socket: " + std::string(strerror(errno)));
         throw std::runtime_error("Failed to listen on socket");
     }
+}
 
-    running_ = true;
-    Logger::info("TCP server listening on port " + std::to_string(port_));
+void TCPServer::inheritSockets(int listener, int local_listener) {
+    if (running_) {
+        Logger::warning("Cannot inherit sockets while running");
+        return;
+    }
+    // The event loop never blocks in accept
+    for (int fd : {listener, local_listener}) {
+        if (fd >= 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+    }
+    server_socket_ = listener;
+    local_socket_ = local_listener;
+}
 
-    // Start accept thread
-    accept_thread_ = std::thread(&TCPServer::acceptLoop, this);
+void TCPServer::handOffListeners() {
+    // stop() must not unlink the socket file the replacement is serving on
+    listeners_handed_off_ = true;
+    post([this]() {
+        // Closing our copies leaves the replacement's open - the ports and
+        // the socket file stay live, new connections just go to it
+        if (server_socket_ >= 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, server_socket_, nullptr);
+            close(server_socket_);
+            server_socket_ = -1;
+        }
+        if (local_socket_ >= 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, local_socket_, nullptr);
+            close(local_socket_);
+            local_socket_ = -1;
+        }
+        Logger::info("Listeners handed off - no longer accepting connections");
+    });
 }
 
 void TCPServer::stop() {
@@ -87,45 +216,223 @@ void TCPServer::stop() {
     Logger::info("Stopping TCP server...");
     running_ = false;
 
-    // Close server socket to unblock accept()
+    // Wake the event loop so it notices running_ == false
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+
+    // The loop closes every client connection before it returns
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
+
+    // Running commands finish first; their results are discarded
+    // (wake_fd_ must stay open until then - completions post() to it)
+    coalescer_.cancel();
+    dispatcher_.stop();
+
     if (server_socket_ >= 0) {
         close(server_socket_);
         server_socket_ = -1;
     }
+    if (local_socket_ >= 0) {
+        close(local_socket_);
+        local_socket_ = -1;
+        if (!listeners_handed_off_) {
+            unlink(local_path_.c_str());
+        }
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
 
-    // Wait for accept thread
-    if (accept_thread_.joinable()) {
-        accept_thread_.join();
+    Logger::info("TCP server stopped");
+}
+
+namespace {
+
+// Connection whose command is running on this worker thread
+struct CommandOrigin {
+    int fd = -1;
+    uint64_t connection_id = 0;
+    const CommandSpec* spec = nullptr;
+    int seq_id = 0;
+    wire::Encoding encoding = wire::Encoding::JSON;
+    std::shared_ptr<StreamWindow> stream_window;  // Set if the client accepts a streamed result
+    std::shared_ptr<ResponseStream> stream;  // Set by openStream()
+};
+thread_local CommandOrigin current_origin;
+
+// Whether a local peer belongs to group gid, as primary or supplementary group.
+// SO_PEERGROUPS (Linux 4.13) gives the groups the peer had when it
+// connected; older kernels fall back to the peer uid's group database entry.
+bool peerInGroup(int fd, const struct ucred& cred, gid_t gid) {
+    if (cred.gid == gid) {
+        return true;
     }
 
-    // Wait for all client threads (they should exit when connections close)
-    for (auto& thread : client_threads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
+    std::vector<gid_t> groups(32);
+    socklen_t len = static_cast<socklen_t>(groups.size() * sizeof(gid_t));
+    int result = getsockopt(fd, SOL_SOCKET, SO_PEERGROUPS, groups.data(), &len);
+    if (result < 0 && errno == ERANGE) {
+        groups.resize(len / sizeof(gid_t));
+        result = getsockopt(fd, SOL_SOCKET, SO_PEERGROUPS, groups.data(), &len);
+    }
+    if (result == 0) {
+        groups.resize(len / sizeof(gid_t));
+        return std::find(groups.begin(), groups.end(), gid) != groups.end();
     }
-    client_threads_.clear();
 
-    Logger::info("TCP server stopped");
+    struct passwd pwd;
+    struct passwd* entry = nullptr;
+    char buffer[1024];
+    if (getpwuid_r(cred.uid, &pwd, buffer, sizeof(buffer), &entry) != 0 || !entry) {
+        return false;
+    }
+    int count = static_cast<int>(groups.size());
+    if (getgrouplist(entry->pw_name, cred.gid, groups.data(), &count) < 0) {
+        groups.resize(static_cast<size_t>(count));
+        if (getgrouplist(entry->pw_name, cred.gid, groups.data(), &count) < 0) {
+            return false;
+        }
+    }
+    groups.resize(static_cast<size_t>(count));
+    return std::find(groups.begin(), groups.end(), gid) != groups.end();
 }
 
-void TCPServer::acceptLoop() {
-    Logger::debug("TCP accept loop started");
+} // namespace
+
+void TCPServer::eventLoop() {
+    Logger::debug("TCP event loop started");
+
+    constexpr int MAX_EVENTS = 16;
+    struct epoll_event events[MAX_EVENTS];
+
+    int timeout_ms = -1;  // Wake for held-back property events and session expiry only
 
     while (running_) {
+        int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::error("epoll_wait failed: " + std::string(strerror(errno)));
+            break;
+        }
+
+        for (int i = 0; i < n && running_; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t mask = events[i].events;
+
+            if (fd == server_socket_) {
+                acceptConnections();
+                continue;
+            }
+
+            if (fd == local_socket_) {
+                acceptLocalConnections();
+                continue;
+            }
+
+            if (fd == wake_fd_) {
+                uint64_t count;
+                while (read(wake_fd_, &count, sizeof(count)) > 0) {}
+                runPostedTasks();
+                continue;
+            }
+
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) {
+                continue;  // Closed earlier in this batch
+            }
+
+            ClientConnection& conn = *it->second;
+
+            if (mask & (EPOLLERR | EPOLLHUP)) {
+                Logger::info("Client " + conn.ip + " disconnected");
+                conn.closing = true;
+            }
+
+            if (!conn.closing && (mask & EPOLLIN)) {
+                handleReadable(conn);
+            }
+
+            if (!conn.closing && (mask & EPOLLOUT)) {
+                handleWritable(conn);
+            }
+
+            if (conn.closing) {
+                closeConnection(fd);
+            }
+        }
+
+        // Everything produced by this batch of events goes out together
+        timeout_ms = flushPropertyEvents();
+        flushPendingOutput();
+        closeFailedConnections();
+
+        // Detached sessions are forgotten on time, not only when a new one
+        // needs room
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_session_expiry_) {
+            expireSessions(false);
+        }
+        if (next_session_expiry_ != std::chrono::steady_clock::time_point::max()) {
+            int expiry_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                next_session_expiry_ - now).count()) + 1;
+            timeout_ms = timeout_ms < 0 ? expiry_ms : std::min(timeout_ms, expiry_ms);
+        }
+    }
+
+    // Deterministic shutdown: every client is closed by the loop that owns it
+    std::vector<int> fds;
+    fds.reserve(connections_.size());
+    for (const auto& entry : connections_) {
+        fds.push_back(entry.first);
+    }
+    for (int fd : fds) {
+        closeConnection(fd);
+    }
+
+    Logger::debug("TCP event loop ended");
+}
+
+void TCPServer::acceptConnections() {
+    while (true) {
         struct sockaddr_in client_addr{};
         socklen_t client_addr_len = sizeof(client_addr);
 
-        int client_socket = accept(server_socket_, (struct sockaddr*)&client_addr, &client_addr_len);
+        int client_socket = accept4(server_socket_, (struct sockaddr*)&client_addr, &client_addr_len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
 
         if (client_socket < 0) {
-            if (running_) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
                 Logger::error("Failed to accept connection: " + std::string(strerror(errno)));
             }
-            break;
+            return;
         }
 
         std::string client_ip = inet_ntoa(client_addr.sin_addr);
+
+        // Refuse before the client can retarget the UDP streams
+        if (static_cast<int>(connections_.size()) - local_clients_ >= config::MAX_TCP_CLIENTS) {
+            stats_.clients_refused++;
+            Logger::warning("Refused connection from " + client_ip + ": " +
+                            std::to_string(config::MAX_TCP_CLIENTS) + " clients already connected");
+            std::string refusal = messages::createErrorResponse(
+                0, "connect", messages::ErrorCode::TOO_MANY_CLIENTS,
+                "Server already has " + std::to_string(config::MAX_TCP_CLIENTS) + " clients"
+            ).dump() + "\n";
+            send(client_socket, refusal.data(), refusal.size(), MSG_NOSIGNAL);  // Best effort
+            close(client_socket);
+            continue;
+        }
+
         Logger::info("Accepted connection from " + client_ip);
 
         // Update UDP broadcasters with client IP (dynamic discovery)
@@ -148,574 +455,975 @@ void TCPServer::acceptLoop() {
             Logger::warning("Failed to set SO_KEEPALIVE: " + std::string(strerror(errno)));
         }
 
-        // Spawn thread to handle client
-        client_threads_.emplace_back(&TCPServer::handleClient, this, client_socket, client_ip);
-        client_threads_.back().detach();  // Detach so it cleans up automatically
+        addConnection(client_socket, client_ip, false);
     }
-
-    Logger::debug("TCP accept loop ended");
 }
 
-void TCPServer::handleClient(int client_socket, const std::string& client_ip) {
-    Logger::debug("Handling client " + client_ip);
-
-    // Add client to active clients list
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        active_clients_.push_back(client_socket);
+void TCPServer::openLocalSocket() {
+    struct sockaddr_un addr{};
+    if (local_path_.size() >= sizeof(addr.sun_path)) {
+        Logger::warning("Local socket path too long, TCP only: " + local_path_);
+        return;
     }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, local_path_.c_str(), local_path_.size() + 1);
 
-    char buffer[config::TCP_BUFFER_SIZE];
-    std::string message_buffer;
+    // The directory (e.g. /run/dpm) does not survive a reboot
+    size_t slash = local_path_.find_last_of('/');
+    if (slash != std::string::npos && slash > 0) {
+        mkdir(local_path_.substr(0, slash).c_str(), 0755);  // EEXIST is fine
+    }
 
-    while (running_) {
-        ssize_t bytes_received = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
+    local_socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (local_socket_ < 0) {
+        Logger::warning("Failed to create local socket: " + std::string(strerror(errno)));
+        return;
+    }
 
-        if (bytes_received < 0) {
-            Logger::error("Failed to receive from " + client_ip + ": " + std::string(strerror(errno)));
-            break;
+    // A socket file left by a previous run makes bind() fail - remove it,
+    // unless another instance is still answering on it
+    if (connect(local_socket_, (struct sockaddr*)&addr, sizeof(addr)) == 0 || errno == EINPROGRESS ||
+        errno == EAGAIN) {
+        Logger::warning("Local socket " + local_path_ + " is in use by another process, TCP only");
+        close(local_socket_);
+        local_socket_ = -1;
+        return;
+    }
+    close(local_socket_);
+    unlink(local_path_.c_str());
+
+    local_socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (local_socket_ < 0 ||
+        bind(local_socket_, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(local_socket_, config::MAX_LOCAL_CLIENTS) < 0) {
+        Logger::warning("Failed to listen on " + local_path_ + ": " + std::string(strerror(errno)) + ", TCP only");
+        if (local_socket_ >= 0) {
+            close(local_socket_);
+            local_socket_ = -1;
         }
+        return;
+    }
 
-        if (bytes_received == 0) {
-            Logger::info("Client " + client_ip + " disconnected");
-            break;
-        }
+    // Owner and group only; every peer is checked again on accept
+    chmod(local_path_.c_str(), 0660);
+
+    struct epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = local_socket_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, local_socket_, &ev);
 
-        buffer[bytes_received] = '\0';
-        message_buffer += buffer;
+    Logger::info("Local command socket listening on " + local_path_);
+}
 
-        // Process complete JSON messages (one per line or complete JSON object)
-        size_t newline_pos;
-        while ((newline_pos = message_buffer.find('\n')) != std::string::npos) {
-            std::string message = message_buffer.substr(0, newline_pos);
-            message_buffer = message_buffer.substr(newline_pos + 1);
+void TCPServer::acceptLocalConnections() {
+    while (true) {
+        int client_socket = accept4(local_socket_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
 
-            if (message.empty()) {
-                continue;
+        if (client_socket < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                Logger::error("Failed to accept local connection: " + std::string(strerror(errno)));
             }
+            return;
+        }
 
-            Logger::debug("Received from " + client_ip + ": " + message);
+        // The kernel vouches for the peer's identity - no handshake secret needed
+        struct ucred cred{};
+        socklen_t cred_len = sizeof(cred);
+        if (getsockopt(client_socket, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0) {
+            Logger::error("Failed to read local peer credentials: " + std::string(strerror(errno)));
+            close(client_socket);
+            continue;
+        }
 
-            try {
-                json command = json::parse(message);
-                json response = processCommand(command);
+        std::string peer = "local:" + std::to_string(cred.pid);
+        if (cred.uid != 0 && cred.uid != geteuid() && !peerInGroup(client_socket, cred, getegid())) {
+            stats_.local_peers_rejected++;
+            Logger::warning("Rejected local peer pid " + std::to_string(cred.pid) +
+                            " (uid " + std::to_string(cred.uid) + ", gid " + std::to_string(cred.gid) + ")");
+            close(client_socket);
+            continue;
+        }
 
-                std::string response_str = response.dump() + "\n";
-                ssize_t bytes_sent = send(client_socket, response_str.c_str(), response_str.size(), 0);
+        if (local_clients_ >= config::MAX_LOCAL_CLIENTS) {
+            Logger::warning("Rejected " + peer + ": " + std::to_string(config::MAX_LOCAL_CLIENTS) +
+                            " local clients already connected");
+            close(client_socket);
+            continue;
+        }
 
-                if (bytes_sent < 0) {
-                    Logger::error("Failed to send to " + client_ip + ": " + std::string(strerror(errno)));
-                    break;
-                }
+        Logger::info("Accepted local connection from pid " + std::to_string(cred.pid) +
+                     " (uid " + std::to_string(cred.uid) + ")");
+        addConnection(client_socket, peer, true);
+    }
+}
 
-                Logger::debug("Sent to " + client_ip + ": " + response_str);
-            } catch (const json::exception& e) {
-                Logger::warning("JSON parse error from " + client_ip + ": " + std::string(e.what()));
+void TCPServer::addConnection(int fd, const std::string& peer, bool local) {
+    auto conn = std::make_unique<ClientConnection>(fd, next_connection_id_++, peer);
+    conn->local = local;
+
+    struct epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    conn->interest = ev.events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        Logger::error("Failed to register client " + peer + ": " + std::string(strerror(errno)));
+        close(fd);
+        return;
+    }
 
-                // Send error response
-                json error_response = messages::createErrorResponse(
-                    0, "unknown", messages::ErrorCode::INVALID_JSON,
-                    "Invalid JSON: " + std::string(e.what())
-                );
+    if (local) {
+        local_clients_++;
+    }
+    connections_[fd] = std::move(conn);
+    Logger::debug("Handling client " + peer + " (active clients: " +
+                  std::to_string(connections_.size()) + ")");
+}
 
-                std::string response_str = error_response.dump() + "\n";
-                send(client_socket, response_str.c_str(), response_str.size(), 0);
-            } catch (const std::exception& e) {
-                Logger::error("Error processing command from " + client_ip + ": " + std::string(e.what()));
-            }
+void TCPServer::handleReadable(ClientConnection& conn) {
+    // Receive straight into the connection's ring buffer (no staging copy)
+    ssize_t bytes_received = recv(conn.fd, conn.reader.writePtr(), conn.reader.writeSpace(), 0);
+
+    if (bytes_received < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return;
         }
+        Logger::error("Failed to receive from " + conn.ip + ": " + std::string(strerror(errno)));
+        conn.closing = true;
+        return;
     }
 
-    // Remove client from active clients list
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        active_clients_.erase(
-            std::remove(active_clients_.begin(), active_clients_.end(), client_socket),
-            active_clients_.end()
-        );
+    if (bytes_received == 0) {
+        Logger::info("Client " + conn.ip + " disconnected");
+        // Commands already dispatched are still answered before closing
+        conn.read_closed = true;
+        handleWritable(conn);
+        return;
     }
 
-    // Remove client from UDP broadcaster and heartbeat
-    if (udp_broadcaster_) {
-        udp_broadcaster_->removeClient(client_ip);
-    }
-    if (heartbeat_) {
-        heartbeat_->removeClient(client_ip);
-    }
+    conn.reader.commitWrite(static_cast<size_t>(bytes_received));
 
-    // Graceful shutdown: stop sending, allow receiving for a moment
-    shutdown(client_socket, SHUT_WR);
+    processFrames(conn);
+}
 
-    // Brief delay to allow final data to be read
-    char discard_buffer[256];
-    recv(client_socket, discard_buffer, sizeof(discard_buffer), MSG_DONTWAIT);
+void TCPServer::processFrames(ClientConnection& conn) {
+    // Process complete JSON messages (one per line), parsed in place
+    std::string_view message;
+    FrameReader::Result result;
+    while (!conn.closing && conn.in_flight < config::TCP_MAX_IN_FLIGHT &&
+           conn.out_bytes < config::TCP_OUTBOUND_HIGH_WATER &&
+           (result = conn.reader.nextFrame(message)) != FrameReader::Result::NEED_MORE) {
+        stats_.frames_received++;
+
+        if (result == FrameReader::Result::FRAME) {
+            handleMessage(conn, message);
+        } else if (result == FrameReader::Result::OVERSIZE) {
+            stats_.frames_oversize++;
+            Logger::warning("Discarded oversize frame from " + conn.ip + " (limit " +
+                            std::to_string(conn.reader.maxFrameSize()) + " bytes)");
+            queueMessage(conn, messages::createErrorResponse(
+                0, "unknown", messages::ErrorCode::INVALID_JSON,
+                "Message exceeds maximum frame size of " + std::to_string(conn.reader.maxFrameSize()) + " bytes"
+            ));
+        } else {
+            stats_.frames_garbage++;
+            Logger::warning("Discarded non-JSON frame from " + conn.ip);
+            queueMessage(conn, messages::createErrorResponse(
+                0, "unknown", messages::ErrorCode::INVALID_JSON,
+                "Invalid JSON: message is not a JSON object"
+            ));
+        }
+    }
 
-    close(client_socket);
-    Logger::info("Disconnected client: " + client_ip);
+    // At either cap this drops EPOLLIN, so TCP flow control pushes back on the client
+    updateInterest(conn);
 }
 
-json TCPServer::processCommand(const json& command) {
+void TCPServer::handleMessage(ClientConnection& conn, std::string_view message) {
+    if (wire::isBinary(conn.encoding)) {
+        Logger::debug("Received " + std::to_string(message.size()) + "-byte " +
+                      wire::encodingToString(conn.encoding) + " frame from " + conn.ip);
+    } else {
+        Logger::debug("Received from " + conn.ip + ": " + std::string(message));
+    }
+
     try {
-        // Validate message structure
-        std::string error;
-        if (!validateMessage(command, error)) {
-            return messages::createErrorResponse(
-                command.value("sequence_id", 0),
-                command.value("payload", json::object()).value("command", "unknown"),
-                messages::ErrorCode::INVALID_JSON,
-                error
+        // One streaming pass picks out the envelope and the payload fields
+        CommandHeader header;
+        std::string parse_error;
+        if (!scanCommandHeader(message, conn.encoding, header, parse_error)) {
+            Logger::warning("JSON parse error from " + conn.ip + ": " + parse_error);
+
+            // Send error response
+            json error_response = messages::createErrorResponse(
+                0, "unknown", messages::ErrorCode::INVALID_JSON,
+                "Invalid " + std::string(wire::encodingToString(conn.encoding)) + ": " + parse_error
             );
+
+            queueMessage(conn, error_response);
+            return;
         }
 
-        int seq_id = command["sequence_id"];
-        std::string message_type = command["message_type"].get<std::string>();
+        // Malformed and unknown commands are answered straight away
+        int seq_id = 0;
+        json payload;
+        json error_response;
+        bool has_deadline = false;
+        deadline::Clock::time_point deadline;
+        const CommandSpec* spec = prepareCommand(header, seq_id, payload,
+                                                 error_response, has_deadline, deadline);
+        if (!spec) {
+            queueMessage(conn, error_response);
+            return;
+        }
 
-        // Handle handshake separately (doesn't use "command" field)
-        if (message_type == "handshake") {
-            Logger::info("Processing handshake");
-            return handleHandshake(command["payload"], seq_id);
+        // A resent command gets the original's response - within the session
+        // instance the connection is attached to. Idempotent commands are
+        // simply run again and would only crowd out the rest; a streamed
+        // result would be cached without its chunks.
+        bool cached_retries = conn.session && !spec->has(FLAG_IDEMPOTENT) && !header.stream;
+
+        // A retry answered from the cache is not charged - those are charged below
+        if (!cached_retries &&
+            !admitCommand(conn.budget, *spec, payload, seq_id, conn.ip, error_response)) {
+            queueMessage(conn, error_response);
+            return;
         }
 
-        // For other messages, get command from payload
-        std::string cmd = command["payload"]["command"];
-        Logger::info("Processing command: " + cmd);
+        // The handshake reply goes out in the current encoding; every frame
+        // after the handshake (in both directions) uses the negotiated one
+        wire::Encoding reply_encoding = conn.encoding;
+        json resume_from;
+        if (spec->name == "handshake") {
+            std::string client_id = payload.value("client_id",
+                                    payload.value("parameters", json::object()).value("client_id", ""));
+            resume_from = payload.contains("resume_from") ? payload["resume_from"] :
+                          payload.value("parameters", json::object()).value("resume_from", json());
+
+            // One live connection per client_id. A fresh handshake under an id
+            // another connection holds is refused; a resuming one takes over,
+            // as the other may be a half-open link not yet seen to drop.
+            if (!client_id.empty() && !resume_from.is_number_integer() && clientIdInUse(client_id, conn)) {
+                Logger::warning("Handshake from " + conn.ip + " refused: client_id " + client_id +
+                                " is in use by another connection");
+                queueMessage(conn, messages::createErrorResponse(
+                    seq_id, spec->name, messages::ErrorCode::CLIENT_ID_IN_USE,
+                    "client_id " + client_id + " is in use by another connection"
+                ));
+                return;
+            }
 
-        // Route to appropriate handler
-        if (cmd == "handshake") {
-            return handleHandshake(command["payload"], seq_id);
-        } else if (cmd == "system.get_status") {
-            return handleSystemGetStatus(command["payload"], seq_id);
-        } else if (cmd == "camera.capture") {
-            return handleCameraCapture(command["payload"], seq_id);
-        } else if (cmd == "camera.focus") {
-            return handleCameraFocus(command["payload"], seq_id);
-        } else if (cmd == "camera.auto_focus_hold") {
-            return handleCameraAutoFocusHold(command["payload"], seq_id);
-        } else if (cmd == "camera.set_property") {
-            return handleCameraSetProperty(command["payload"], seq_id);
-        } else if (cmd == "camera.get_properties") {
-            return handleCameraGetProperties(command["payload"], seq_id);
-        } else {
-            // Check if it's a Phase 2 command
-            if (cmd.find("camera.") == 0 || cmd.find("gimbal.") == 0) {
-                return messages::createErrorResponse(
-                    seq_id, cmd,
-                    messages::ErrorCode::COMMAND_NOT_IMPLEMENTED,
-                    "This command will be implemented in Phase 2"
-                );
-            } else {
-                return messages::createErrorResponse(
-                    seq_id, cmd,
-                    messages::ErrorCode::UNKNOWN_COMMAND,
-                    "Unknown command: " + cmd
-                );
+            conn.encoding = wire::negotiate(payload);
+            conn.reader.setFraming(wire::isBinary(conn.encoding) ?
+                                   FrameReader::Framing::LENGTH_PREFIXED :
+                                   FrameReader::Framing::NEWLINE);
+            conn.client_id = client_id;
+
+            // UDP status: full messages unless the client takes the delta stream
+            if (udp_broadcaster_ && !conn.local) {
+                std::string status_stream = payload.value("status_stream",
+                                            payload.value("parameters", json::object()).value("status_stream", "full"));
+                udp_broadcaster_->setClientDeltaStatus(conn.ip, status_stream == "delta");
             }
         }
+
+        conn.in_flight++;
+        if (conn.in_flight >= config::TCP_MAX_IN_FLIGHT) {
+            stats_.in_flight_limited++;
+        }
+
+        // Always post back, even on failure - the connection's in-flight slot must be released
+        std::function<void(std::string)> complete = [this, fd = conn.fd, id = conn.id](std::string response) {
+            post([this, fd, id, response = std::move(response)]() {
+                completeCommand(fd, id, response);
+            });
+        };
+
+        // The session is attached after the handshake reply, so anything
+        // replayed follows it in the negotiated encoding
+        if (spec->name == "handshake" && !conn.client_id.empty()) {
+            bool resume = resume_from.is_number_integer();
+            int last_seen = resume ? resume_from.get<int>() : 0;
+            conn.resuming = resume;
+            complete = [this, fd = conn.fd, id = conn.id, client_id = conn.client_id,
+                        resume, last_seen](std::string response) {
+                post([this, fd, id, client_id, resume, last_seen, response = std::move(response)]() {
+                    completeCommand(fd, id, response);
+                    resumeSession(fd, id, client_id, resume, last_seen);
+                });
+            };
+        }
+
+        std::function<void(std::string, bool)> deliver = [complete](std::string response, bool) {
+            complete(std::move(response));
+        };
+
+        if (cached_retries) {
+            std::string scope = conn.session->cache_scope;
+            uint64_t fingerprint = ResponseCache::fingerprint(payload.dump());
+            std::string cached;
+            wire::Encoding cached_encoding = reply_encoding;
+            auto waiter = [complete, reply_encoding](const std::string& frame, wire::Encoding encoding) {
+                complete(wire::transcode(frame, encoding, reply_encoding));
+            };
+
+            switch (response_cache_.lookup(scope, seq_id, fingerprint, cached, cached_encoding, waiter)) {
+                case ResponseCache::Lookup::HIT:
+                    stats_.retries_from_cache++;
+                    Logger::info("Retry of " + spec->name + " #" + std::to_string(seq_id) + " from " +
+                                 conn.client_id + " answered from cache");
+                    complete(wire::transcode(cached, cached_encoding, reply_encoding));
+                    return;
+                case ResponseCache::Lookup::PENDING:
+                    stats_.retries_joined++;
+                    Logger::info("Retry of " + spec->name + " #" + std::to_string(seq_id) + " from " +
+                                 conn.client_id + " waiting for the original");
+                    return;
+                case ResponseCache::Lookup::MISS:
+                    break;
+            }
+
+            // Refused commands are not recorded - the resend runs afresh
+            if (!admitCommand(conn.budget, *spec, payload, seq_id, conn.ip, error_response)) {
+                std::string refused = wire::encode(error_response, reply_encoding);
+                response_cache_.complete(scope, seq_id, fingerprint, refused, reply_encoding, false);
+                complete(std::move(refused));
+                return;
+            }
+
+            // Only a success is kept - a failure (or an expired or superseded
+            // command) reaches the retries already waiting, and a later resend
+            // runs again
+            deliver = [this, complete, scope, seq_id, fingerprint,
+                       reply_encoding](std::string response, bool succeeded) {
+                response_cache_.complete(scope, seq_id, fingerprint, response, reply_encoding, succeeded);
+                complete(std::move(response));
+            };
+        }
+
+        std::shared_ptr<StreamWindow> stream_window;
+        if (header.stream) {
+            if (!conn.stream_window) {
+                conn.stream_window = std::make_shared<StreamWindow>();
+            }
+            stream_window = conn.stream_window;
+        }
+
+        dispatchCommand(*spec, seq_id, std::move(payload), reply_encoding, has_deadline, deadline,
+                        conn.fd, conn.id, conn.ip, std::move(deliver), conn.budget.camera_refunds,
+                        std::move(stream_window));
     } catch (const std::exception& e) {
-        Logger::error("Exception in processCommand: " + std::string(e.what()));
-        return messages::createErrorResponse(
-            0, "unknown",
-            messages::ErrorCode::INTERNAL_ERROR,
-            std::string(e.what())
-        );
+        Logger::error("Error processing command from " + conn.ip + ": " + std::string(e.what()));
     }
 }
 
-json TCPServer::handleHandshake(const json& payload, int seq_id) {
-    // Handle both old format (with "parameters") and new format (direct fields)
-    std::string client_id = payload.value("client_id",
-                            payload.value("parameters", json::object()).value("client_id", "unknown"));
-    std::string client_version = payload.value("client_version",
-                                 payload.value("parameters", json::object()).value("client_version", "unknown"));
-
-    Logger::info("Handshake from client: " + client_id + " v" + client_version);
+bool TCPServer::admitCommand(CommandBudget& budget, const CommandSpec& spec, const json& payload,
+                             int seq_id, const std::string& peer, json& error_response) {
+    // Tokens of superseded commands come back first; a batch pays per item
+    int refunds = budget.camera_refunds->exchange(0);
+    if (refunds > 0) {
+        budget.camera.refund(refunds);
+    }
 
-    // Build capabilities list
-    json capabilities = json::array();
-    for (int i = 0; i < config::CAPABILITIES_COUNT; ++i) {
-        capabilities.push_back(config::CAPABILITIES[i]);
+    double cost = 1.0;
+    if (spec.name == "batch") {
+        cost = static_cast<double>(std::max<size_t>(1, payload["parameters"]["commands"].size()));
     }
 
-    json result = {
-        {"server_id", config::SERVER_ID},
-        {"server_version", config::SERVER_VERSION},
-        {"capabilities", capabilities}
-    };
+    bool camera = spec.has(FLAG_CAMERA_EXCLUSIVE);
+    TokenBucket& bucket = camera ? budget.camera : budget.general;
+    int64_t retry_after_ms = 0;
+    if (bucket.take(cost, retry_after_ms)) {
+        return true;
+    }
 
-    return messages::createSuccessResponse(seq_id, "handshake", result);
+    stats_.commands_rate_limited++;
+    if (camera) {
+        stats_.camera_commands_rate_limited++;
+    }
+    Logger::debug("Rate limited " + spec.name + " #" + std::to_string(seq_id) + " from " +
+                  peer + " (retry after " + std::to_string(retry_after_ms) + "ms)");
+    error_response = messages::createRateLimitedResponse(seq_id, spec.name, retry_after_ms);
+    return false;
 }
 
-json TCPServer::handleSystemGetStatus(const json& payload, int seq_id) {
-    messages::SystemStatus system = SystemInfo::getStatus();
+void TCPServer::dispatchCommand(const CommandSpec& spec, int seq_id, json payload, wire::Encoding reply_encoding,
+                                bool has_deadline, deadline::Clock::time_point deadline,
+                                int fd, uint64_t connection_id, const std::string& peer,
+                                std::function<void(std::string, bool)> deliver, CommandBudget::Refunds refunds,
+                                std::shared_ptr<StreamWindow> stream_window) {
+    stats_.commands_dispatched++;
+
+    CommandDispatcher::Lane lane = spec.has(FLAG_CAMERA_EXCLUSIVE) ?
+                                   CommandDispatcher::Lane::CAMERA :
+                                   CommandDispatcher::Lane::GENERAL;
+
+    // Camera lane order: shutter and focus ahead of property traffic. A batch
+    // holds the camera for all its commands, so it goes as its most urgent one.
+    CameraAccess::Priority priority = CameraAccess::Priority::PROPERTY;
+    if (spec.has(FLAG_CAMERA_URGENT)) {
+        priority = CameraAccess::Priority::CAPTURE;
+    } else if (spec.name == "batch") {
+        for (const auto& item : payload["parameters"]["commands"]) {
+            const CommandSpec* member = item.is_object() ? registry_.find(item.value("command", "")) : nullptr;
+            if (member && member->has(FLAG_CAMERA_URGENT)) {
+                priority = CameraAccess::Priority::CAPTURE;
+                break;
+            }
+        }
+    }
+
+    // Last-writer-wins commands may be replaced while they wait in the queue
+    CommandCoalescer::Ticket ticket;
+    if (!spec.coalesce_by.empty()) {
+        const json& target = payload["parameters"][spec.coalesce_by];
+        ticket = coalescer_.arrive(spec.name + ":" +
+                                   (target.is_string() ? target.get<std::string>() : target.dump()),
+                                   seq_id);
+    }
+
+    auto found = metrics_.find(spec.name);
+    CommandMetrics* metrics = found != metrics_.end() ? found->second.get() : nullptr;
+    auto submitted = std::chrono::steady_clock::now();
+
+    dispatcher_.submit(lane, [this, spec = &spec, lane, priority, seq_id, reply_encoding, has_deadline, deadline,
+                              ticket = std::move(ticket), fd, id = connection_id, client_ip = peer,
+                              payload = std::move(payload), deliver = std::move(deliver),
+                              refunds = std::move(refunds), stream_window = std::move(stream_window), metrics, submitted]() {
+        auto started = std::chrono::steady_clock::now();
+        CameraAccess::PriorityScope camera_priority(priority);
+        CameraAccess::Usage& camera_usage = CameraAccess::threadUsage();
+        camera_usage = CameraAccess::Usage{};
+
+        // Serialize on the worker - keeps encoding cost off the event loop
+        std::string response_str;
+        bool executed = false;
+        bool succeeded = false;
+        std::shared_ptr<ResponseStream> stream;
+        try {
+            int superseded_by = 0;
+            auto camera_work_queued = [this, lane]() { return dispatcher_.pending(lane) > 0; };
+            if (ticket.id != 0 && !coalescer_.begin(ticket, superseded_by, camera_work_queued)) {
+                stats_.commands_superseded++;
+                if (refunds) {
+                    (*refunds)++;  // It never reached the camera
+                }
+                Logger::debug(spec->name + " #" + std::to_string(seq_id) +
+                              " superseded by #" + std::to_string(superseded_by));
+                response_str = wire::encode(messages::createSupersededResponse(
+                    seq_id, spec->name, superseded_by
+                ), reply_encoding);
+            } else {
+                current_origin = CommandOrigin{fd, id, spec, seq_id, reply_encoding, stream_window, nullptr};
+                json response = executeCommand(*spec, payload, seq_id, has_deadline, deadline);
+                stream = std::move(current_origin.stream);
+                current_origin = CommandOrigin{};
+                executed = true;
+                if (!stream) {
+                    succeeded = response["payload"].value("status", "") == "success";
+                    response_str = wire::encode(response, reply_encoding);
+                }
+            }
+        } catch (const std::exception& e) {
+            Logger::error("Failed to serialize " + spec->name + " response: " + std::string(e.what()));
+            response_str = wire::encode(messages::createErrorResponse(
+                seq_id, spec->name, messages::ErrorCode::INTERNAL_ERROR, std::string(e.what())
+            ), reply_encoding);
+        }
+
+        // Superseded commands never ran - they would only dilute the numbers
+        if (metrics && executed) {
+            metrics->queue_wait.record(started - submitted);
+            metrics->camera_wait.record(camera_usage.waited);
+            metrics->sdk.record(camera_usage.held);
+            metrics->total.record(std::chrono::steady_clock::now() - submitted);
+        }
+
+        // Waiting for a slow reader must not hold this lane (the camera)
+        if (stream) {
+            dispatcher_.submit(CommandDispatcher::Lane::GENERAL,
+                               [stream, deliver, reply_encoding]() {
+                json response = stream->finish();
+                bool succeeded = response["payload"].value("status", "") == "success";
+                deliver(wire::encode(response, reply_encoding), succeeded);
+            });
+            return;
+        }
+
+        if (wire::isBinary(reply_encoding)) {
+            Logger::debug("Sent " + std::to_string(response_str.size()) + "-byte " +
+                          wire::encodingToString(reply_encoding) + " frame to " + client_ip);
+        } else {
+            Logger::debug("Sent to " + client_ip + ": " + response_str);
+        }
 
-    return messages::createSuccessResponse(seq_id, "system.get_status", system.toJson());
+        deliver(std::move(response_str), succeeded);
+    }, priority);
 }
 
-json TCPServer::handleCameraCapture(const json& payload, int seq_id) {
-    (void)payload; // Suppress unused parameter warning
+void TCPServer::submitCommand(CommandHeader& header, CommandBudget& budget, const std::string& peer,
+                              std::function<void(std::string)> deliver) {
+    try {
+        int seq_id = 0;
+        json payload;
+        json error_response;
+        bool has_deadline = false;
+        deadline::Clock::time_point deadline;
+        const CommandSpec* spec = prepareCommand(header, seq_id, payload,
+                                                 error_response, has_deadline, deadline);
+        if (!spec || !admitCommand(budget, *spec, payload, seq_id, peer, error_response)) {
+            deliver(error_response.dump());
+            return;
+        }
 
-    // Check if camera is available
-    if (!camera_) {
-        return messages::createErrorResponse(
-            seq_id, "camera.capture",
-            messages::ErrorCode::INTERNAL_ERROR,
-            "Camera interface not initialized"
-        );
-    }
+        // These transports carry JSON only - don't offer the handshake a choice
+        if (spec->name == "handshake") {
+            payload.erase("encodings");
+        }
 
-    // Check if camera is connected
-    // Note: We don't attempt immediate reconnection here to avoid blocking the TCP handler thread
-    // The health check thread handles reconnection every 30 seconds
-    if (!camera_->isConnected()) {
-        Logger::warning("Camera not connected - cannot capture");
-        return messages::createErrorResponse(
-            seq_id, "camera.capture",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Camera not connected. Reconnection in progress, please retry in a few seconds."
-        );
+        dispatchCommand(*spec, seq_id, std::move(payload), wire::Encoding::JSON, has_deadline, deadline,
+                        -1, 0, peer, [deliver = std::move(deliver)](std::string response, bool) {
+            deliver(std::move(response));
+        }, budget.camera_refunds);
+    } catch (const std::exception& e) {
+        Logger::error("Error processing command from " + peer + ": " + std::string(e.what()));
     }
+}
 
-    // Trigger capture
-    Logger::info("Executing camera.capture command");
-    bool success = camera_->capture();
+void TCPServer::queueStreamFrame(int fd, uint64_t connection_id, StreamWindow& window, std::string frame) {
+    window.arrived(frame.size());
 
-    if (!success) {
-        return messages::createErrorResponse(
-            seq_id, "camera.capture",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Failed to trigger camera shutter"
-        );
+    auto it = connections_.find(fd);
+    if (it == connections_.end() || it->second->id != connection_id) {
+        return;  // Client went away - its window is closed, so the stream stops
     }
 
-    // Return success response
-    json result = {
-        {"status", "captured"},
-        {"message", "Shutter released successfully"}
-    };
-
-    return messages::createSuccessResponse(seq_id, "camera.capture", result);
+    ClientConnection& conn = *it->second;
+    if (queueOutput(conn, std::move(frame))) {
+        stats_.stream_chunks_sent++;
+    }
+    window.update(conn.out_bytes);
 }
 
-json TCPServer::handleCameraFocus(const json& payload, int seq_id) {
-    // Check if camera is available
-    if (!camera_) {
-        return messages::createErrorResponse(
-            seq_id, "camera.focus",
-            messages::ErrorCode::INTERNAL_ERROR,
-            "Camera interface not initialized"
-        );
+void TCPServer::completeCommand(int fd, uint64_t connection_id, const std::string& response) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end() || it->second->id != connection_id) {
+        return;  // Client went away while the command was running
     }
 
-    // Check if camera is connected
-    if (!camera_->isConnected()) {
-        Logger::warning("Camera not connected - cannot focus");
-        return messages::createErrorResponse(
-            seq_id, "camera.focus",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Camera not connected. Reconnection in progress, please retry in a few seconds."
-        );
+    ClientConnection& conn = *it->second;
+    conn.in_flight--;
+
+    if (!queueOutput(conn, response)) {
+        return;
     }
 
-    // Validate parameters object exists
-    if (!payload.contains("parameters")) {
-        return messages::createErrorResponse(
-            seq_id, "camera.focus",
-            messages::ErrorCode::INVALID_JSON,
-            "Missing required 'parameters' object"
-        );
+    // A slot is free - resume frames held back by the in-flight cap
+    processFrames(conn);
+}
+
+bool TCPServer::queueOutput(ClientConnection& conn, std::string data, Overflow policy) {
+    if (conn.closing) {
+        return false;
     }
 
-    const json& params = payload["parameters"];
+    if (conn.out_bytes + data.size() > config::TCP_MAX_OUTBOUND_BYTES) {
+        if (policy == Overflow::DROP) {
+            stats_.messages_dropped++;
+            Logger::debug("Outbound queue full for " + conn.ip + " - dropped message");
+            return false;
+        }
 
-    // Validate payload contains "action" field
-    if (!params.contains("action")) {
-        return messages::createErrorResponse(
-            seq_id, "camera.focus",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Missing required field: action"
-        );
+        stats_.slow_client_disconnects++;
+        Logger::warning("Client " + conn.ip + " is not reading responses (" +
+                        std::to_string(conn.out_bytes) + " bytes queued) - disconnecting");
+        conn.closing = true;
+        return false;
     }
 
-    std::string action = params["action"];
+    conn.out_bytes += data.size();
+    conn.out_queue.push_back(std::move(data));
 
-    // Validate action value
-    if (action != "near" && action != "far" && action != "stop") {
-        return messages::createErrorResponse(
-            seq_id, "camera.focus",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Invalid action value: " + action + " (valid: near, far, stop)"
-        );
+    // Sent at the end of this loop iteration (or on EPOLLOUT if the socket is full)
+    if (!conn.flush_pending && !conn.write_blocked) {
+        conn.flush_pending = true;
+        pending_flush_.push_back(conn.fd);
     }
 
-    // Get optional speed parameter (default: 3 = fast)
-    int speed = 3;
-    if (params.contains("speed")) {
-        speed = params["speed"];
-        // Validate speed range
-        if (speed < 1 || speed > 3) {
-            return messages::createErrorResponse(
-                seq_id, "camera.focus",
-                messages::ErrorCode::COMMAND_FAILED,
-                "Invalid speed value: " + std::to_string(speed) + " (valid: 1-3)"
-            );
+    return true;
+}
+
+bool TCPServer::queueMessage(ClientConnection& conn, const json& message, Overflow policy) {
+    return queueOutput(conn, wire::encode(message, conn.encoding), policy);
+}
+
+void TCPServer::flushPendingOutput() {
+    // Flushing can resume held-back commands, which may queue more output
+    while (!pending_flush_.empty()) {
+        std::vector<int> fds;
+        fds.swap(pending_flush_);
+
+        for (int fd : fds) {
+            auto it = connections_.find(fd);
+            if (it == connections_.end() || !it->second->flush_pending) {
+                continue;
+            }
+
+            ClientConnection& conn = *it->second;
+            conn.flush_pending = false;
+            if (!conn.closing) {
+                handleWritable(conn);
+            }
         }
     }
+}
 
-    // Execute focus operation
-    Logger::info("Executing camera.focus command: action=" + action + ", speed=" + std::to_string(speed));
-    bool success = camera_->focus(action, speed);
+void TCPServer::handleWritable(ClientConnection& conn) {
+    constexpr size_t MAX_IOV = 64;
 
-    if (!success) {
-        return messages::createErrorResponse(
-            seq_id, "camera.focus",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Failed to execute focus action: " + action
-        );
-    }
+    conn.write_blocked = false;
 
-    // Read focal distance after focus operation
-    float focal_distance_m = camera_->getFocalDistanceMeters();
+    while (!conn.out_queue.empty()) {
+        // Gather queued messages into one call
+        struct iovec iov[MAX_IOV];
+        size_t iov_count = 0;
+        for (auto it = conn.out_queue.begin(); it != conn.out_queue.end() && iov_count < MAX_IOV; ++it) {
+            size_t skip = iov_count == 0 ? conn.out_offset : 0;
+            iov[iov_count].iov_base = it->data() + skip;
+            iov[iov_count].iov_len = it->size() - skip;
+            ++iov_count;
+        }
 
-    // Return success response
-    json result = {
-        {"action", action},
-        {"speed", speed}
-    };
+        // sendmsg() is writev() with flags - MSG_NOSIGNAL avoids SIGPIPE
+        struct msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_count;
+        ssize_t bytes_sent = sendmsg(conn.fd, &msg, MSG_NOSIGNAL);
+
+        if (bytes_sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn.write_blocked = true;  // Kernel buffer full - wait for EPOLLOUT
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::error("Failed to send to " + conn.ip + ": " + std::string(strerror(errno)));
+            conn.closing = true;
+            return;
+        }
+
+        stats_.send_calls++;
 
-    // Include focal distance if available
-    if (focal_distance_m > 0.0f) {
-        result["focus_distance_m"] = focal_distance_m;
-    } else if (focal_distance_m == -1.0f) {
-        result["focus_distance_m"] = "infinity";
+        // Retire fully sent messages; a partial one keeps its offset
+        size_t remaining = static_cast<size_t>(bytes_sent);
+        conn.out_bytes -= remaining;
+        while (remaining > 0) {
+            size_t left = conn.out_queue.front().size() - conn.out_offset;
+            if (remaining < left) {
+                conn.out_offset += remaining;
+                break;
+            }
+            remaining -= left;
+            conn.out_queue.pop_front();
+            conn.out_offset = 0;
+            stats_.messages_sent++;
+        }
     }
-    // If < 0 but not -1, omit (error reading)
 
-    return messages::createSuccessResponse(seq_id, "camera.focus", result);
-}
+    // Let stream producers waiting on this client continue
+    if (conn.stream_window) {
+        conn.stream_window->update(conn.out_bytes);
+    }
 
-json TCPServer::handleCameraAutoFocusHold(const json& payload, int seq_id) {
-    // Check if camera is available
-    if (!camera_) {
-        return messages::createErrorResponse(
-            seq_id, "camera.auto_focus_hold",
-            messages::ErrorCode::INTERNAL_ERROR,
-            "Camera interface not initialized"
-        );
+    // Below the high-water mark again - resume commands held back in the reader
+    if (conn.reader.buffered() > 0 && conn.out_bytes < config::TCP_OUTBOUND_HIGH_WATER) {
+        processFrames(conn);
+        if (conn.closing) {
+            return;
+        }
     }
 
-    // Check if camera is connected
-    if (!camera_->isConnected()) {
-        Logger::warning("Camera not connected - cannot trigger auto-focus hold");
-        return messages::createErrorResponse(
-            seq_id, "camera.auto_focus_hold",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Camera not connected. Reconnection in progress, please retry in a few seconds."
-        );
+    // Peer has finished sending and every response has been flushed
+    if (conn.read_closed && conn.in_flight == 0 && conn.out_queue.empty()) {
+        conn.closing = true;
+        return;
     }
 
-    // Validate parameters object exists
-    if (!payload.contains("parameters")) {
-        return messages::createErrorResponse(
-            seq_id, "camera.auto_focus_hold",
-            messages::ErrorCode::INVALID_JSON,
-            "Missing required 'parameters' object"
-        );
+    updateInterest(conn);
+}
+
+void TCPServer::updateInterest(ClientConnection& conn) {
+    uint32_t events = 0;
+    if (!conn.read_closed && conn.in_flight < config::TCP_MAX_IN_FLIGHT &&
+        conn.out_bytes < config::TCP_OUTBOUND_HIGH_WATER) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (conn.write_blocked) {
+        events |= EPOLLOUT;
     }
 
-    const json& params = payload["parameters"];
+    if (events == conn.interest) {
+        return;
+    }
 
-    // Validate payload contains "state" field
-    if (!params.contains("state")) {
-        return messages::createErrorResponse(
-            seq_id, "camera.auto_focus_hold",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Missing required field: state"
-        );
+    struct epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = conn.fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev) == 0) {
+        conn.interest = events;
     }
+}
 
-    std::string state = params["state"];
+void TCPServer::closeConnection(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
 
-    // Validate state value
-    if (state != "press" && state != "release") {
-        return messages::createErrorResponse(
-            seq_id, "camera.auto_focus_hold",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Invalid state value: " + state + " (valid: press, release)"
-        );
+    std::string client_ip = it->second->ip;
+    bool local = it->second->local;
+    if (it->second->stream_window) {
+        it->second->stream_window->close();
     }
+    detachSession(*it->second);
+    connections_.erase(it);
 
-    // Execute auto-focus hold operation
-    Logger::info("Executing camera.auto_focus_hold command: state=" + state);
-    bool success = camera_->autoFocusHold(state);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
 
-    if (!success) {
-        return messages::createErrorResponse(
-            seq_id, "camera.auto_focus_hold",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Failed to execute auto-focus hold: " + state
-        );
+    // Remove client from UDP broadcaster and heartbeat (local peers were never added)
+    if (local) {
+        local_clients_--;
+    } else {
+        if (udp_broadcaster_) {
+            udp_broadcaster_->removeClient(client_ip);
+        }
+        if (heartbeat_) {
+            heartbeat_->removeClient(client_ip);
+        }
     }
 
-    // Return success response
-    json result = {
-        {"state", state}
-    };
+    // Graceful shutdown: stop sending, discard anything still pending
+    shutdown(fd, SHUT_WR);
+
+    char discard_buffer[256];
+    recv(fd, discard_buffer, sizeof(discard_buffer), MSG_DONTWAIT);
 
-    return messages::createSuccessResponse(seq_id, "camera.auto_focus_hold", result);
+    close(fd);
+    Logger::info("Disconnected client: " + client_ip);
 }
 
-json TCPServer::handleCameraSetProperty(const json& payload, int seq_id) {
-    // Check if camera is available
-    if (!camera_) {
-        return messages::createErrorResponse(
-            seq_id, "camera.set_property",
-            messages::ErrorCode::INTERNAL_ERROR,
-            "Camera interface not initialized"
-        );
+void TCPServer::closeFailedConnections() {
+    std::vector<int> failed;
+    for (const auto& entry : connections_) {
+        if (entry.second->closing) {
+            failed.push_back(entry.first);
+        }
     }
+    for (int fd : failed) {
+        closeConnection(fd);
+    }
+}
 
-    // Check if camera is connected
-    // Note: We don't attempt immediate reconnection here to avoid blocking the TCP handler thread
-    // The health check thread handles reconnection every 30 seconds
-    if (!camera_->isConnected()) {
-        Logger::warning("Camera not connected - cannot set property");
-        return messages::createErrorResponse(
-            seq_id, "camera.set_property",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Camera not connected. Reconnection in progress, please retry in a few seconds."
-        );
+void TCPServer::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        posted_tasks_.push_back(std::move(task));
     }
 
-    // Validate parameters
-    if (!payload.contains("parameters")) {
-        return messages::createErrorResponse(
-            seq_id, "camera.set_property",
-            messages::ErrorCode::INVALID_JSON,
-            "Missing required 'parameters' object"
-        );
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+void TCPServer::runPostedTasks() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        tasks.swap(posted_tasks_);
     }
 
-    const auto& params = payload["parameters"];
-    if (!params.contains("property") || !params.contains("value")) {
-        return messages::createErrorResponse(
-            seq_id, "camera.set_property",
-            messages::ErrorCode::INVALID_JSON,
-            "Missing required parameters: property and value"
-        );
+    for (auto& task : tasks) {
+        task();
     }
+}
+
+const CommandSpec* TCPServer::prepareCommand(CommandHeader& header, int& seq_id, json& payload,
+                                             json& error_response, bool& has_deadline,
+                                             deadline::Clock::time_point& deadline) {
+    deadline::Clock::time_point received = deadline::Clock::now();
+    try {
+        // Validate message structure
+        std::string error;
+        if (!validateCommandHeader(header, error)) {
+            error_response = messages::createErrorResponse(
+                header.sequence_id,
+                header.has_command ? header.command : "unknown",
+                messages::ErrorCode::INVALID_JSON,
+                error
+            );
+            return nullptr;
+        }
 
-    std::string property = params["property"].get<std::string>();
-    std::string value = params["value"].is_string() ?
-                        params["value"].get<std::string>() :
-                        std::to_string(params["value"].get<int>());
+        seq_id = header.sequence_id;
 
-    Logger::info("Executing camera.set_property: " + property + " = " + value);
+        // Handshake messages don't carry a "command" field
+        const std::string& cmd = header.message_type == "handshake" ? std::string("handshake") : header.command;
+        Logger::info("Processing command: " + cmd);
 
-    // Set the property
-    bool success = camera_->setProperty(property, value);
+        const CommandSpec* spec = registry_.find(cmd);
+        if (!spec) {
+            // In the spec (or a known family) but nothing registered to run it
+            if (schema::findCommand(cmd) || cmd.find("camera.") == 0 || cmd.find("gimbal.") == 0) {
+                error_response = messages::createErrorResponse(
+                    seq_id, cmd,
+                    messages::ErrorCode::COMMAND_NOT_IMPLEMENTED,
+                    "This command will be implemented in Phase 2"
+                );
+            } else {
+                error_response = messages::createErrorResponse(
+                    seq_id, cmd,
+                    messages::ErrorCode::UNKNOWN_COMMAND,
+                    "Unknown command: " + cmd
+                );
+            }
+            return nullptr;
+        }
 
-    if (!success) {
-        return messages::createErrorResponse(
-            seq_id, "camera.set_property",
-            messages::ErrorCode::COMMAND_FAILED,
-            "Failed to set camera property: " + property
-        );
-    }
+        // Parameters (and other payload fields, like the handshake's) were
+        // built into a DOM during the scan; the rest of the envelope never is
+        payload = header.takePayload();
 
-    // Read back actual value from camera for verification
-    std::string actual_value = camera_->getProperty(property);
-    if (!actual_value.empty()) {
-        Logger::info("Property comparison - Requested: '" + value + "' → Camera has: '" + actual_value + "'");
-    } else {
-        Logger::warning("Could not read back property value from camera");
-    }
+        messages::ErrorCode error_code = messages::ErrorCode::INVALID_PARAMETER;
+        if (!registry_.validateParameters(*spec, payload, error_code, error)) {
+            error_response = messages::createErrorResponse(seq_id, cmd, error_code, error);
+            return nullptr;
+        }
 
-    // Return success response
-    json result = {
-        {"property", property},
-        {"value", value},
-        {"status", "success"}
-    };
+        if (!deadline::fromEnvelope(header.deadline_ms, header.max_age_ms, received,
+                                    has_deadline, deadline, error)) {
+            error_response = messages::createErrorResponse(
+                seq_id, cmd, messages::ErrorCode::INVALID_PARAMETER, error
+            );
+            return nullptr;
+        }
 
-    return messages::createSuccessResponse(seq_id, "camera.set_property", result);
-}
+        // Already stale on arrival (e.g. held up on the link)
+        if (has_deadline && deadline <= received) {
+            stats_.commands_expired++;
+            int64_t overdue_ms = deadline::overdueMs(deadline);
+            Logger::warning("Dropping stale " + cmd + " (" + std::to_string(overdue_ms) + "ms past deadline on arrival)");
+            error_response = messages::createErrorResponse(
+                seq_id, cmd, messages::ErrorCode::COMMAND_EXPIRED,
+                "Command expired " + std::to_string(overdue_ms) + "ms before dispatch - not executed"
+            );
+            return nullptr;
+        }
 
-json TCPServer::handleCameraGetProperties(const json& payload, int seq_id) {
-    // Check if camera is available
-    if (!camera_) {
-        return messages::createErrorResponse(
-            seq_id, "camera.get_properties",
+        return spec;
+    } catch (const std::exception& e) {
+        Logger::error("Exception in prepareCommand: " + std::string(e.what()));
+        error_response = messages::createErrorResponse(
+            0, "unknown",
             messages::ErrorCode::INTERNAL_ERROR,
-            "Camera interface not initialized"
+            std::string(e.what())
         );
+        return nullptr;
     }
+}
 
-    // Check if camera is connected, attempt immediate reconnection if needed
-    if (!camera_->isConnected()) {
-        Logger::info("Camera not connected - attempting immediate reconnection for get_properties command");
-
-        bool reconnected = camera_->connect();
-        if (reconnected) {
-            Logger::info("Camera reconnected successfully!");
-
-            // Send notification about reconnection
-            sendNotification(
-                messages::NotificationLevel::INFO,
-                messages::NotificationCategory::CAMERA,
-                "Camera Connected",
-                "Camera successfully reconnected and ready",
-                "",
-                true
-            );
-        } else {
-            Logger::warning("Camera reconnection failed");
+json TCPServer::executeCommand(const CommandSpec& spec, const json& payload, int seq_id,
+                               bool has_deadline, deadline::Clock::time_point deadline) {
+    // Handlers check deadline::expired() again right before driving the camera
+    deadline::Scope scope(has_deadline, deadline);
+    try {
+        int64_t overdue_ms = 0;
+        if (deadline::expired(&overdue_ms)) {
+            stats_.commands_expired++;
+            Logger::warning("Dropping stale " + spec.name + " (" + std::to_string(overdue_ms) + "ms past deadline in queue)");
             return messages::createErrorResponse(
-                seq_id, "camera.get_properties",
-                messages::ErrorCode::COMMAND_FAILED,
-                "Camera not connected"
+                seq_id, spec.name, messages::ErrorCode::COMMAND_EXPIRED,
+                "Command expired " + std::to_string(overdue_ms) + "ms ago while queued - not executed"
             );
         }
-    }
 
-    // Validate parameters
-    if (!payload.contains("parameters")) {
+        json response = spec.handler(payload, seq_id);
+        if (scope.triggered()) {
+            stats_.commands_expired++;
+        }
+        return response;
+    } catch (const std::exception& e) {
+        Logger::error("Exception in " + spec.name + ": " + std::string(e.what()));
         return messages::createErrorResponse(
-            seq_id, "camera.get_properties",
-            messages::ErrorCode::INVALID_JSON,
-            "Missing required parameter: parameters"
+            seq_id, spec.name,
+            messages::ErrorCode::INTERNAL_ERROR,
+            std::string(e.what())
         );
     }
+}
 
-    json parameters = payload["parameters"];
-    if (!parameters.contains("properties")) {
-        return messages::createErrorResponse(
-            seq_id, "camera.get_properties",
-            messages::ErrorCode::INVALID_JSON,
-            "Missing required parameter: properties (array)"
-        );
+json TCPServer::handleHandshake(const json& payload, int seq_id) {
+    // Handle both old format (with "parameters") and new format (direct fields)
+    std::string client_id = payload.value("client_id",
+                            payload.value("parameters", json::object()).value("client_id", "unknown"));
+    std::string client_version = payload.value("client_version",
+                                 payload.value("parameters", json::object()).value("client_version", "unknown"));
+
+    Logger::info("Handshake from client: " + client_id + " v" + client_version);
+
+    // Only the negotiated encoding and resume point vary per client
+    json result = handshake_result_;
+    result["encoding"] = wire::encodingToString(wire::negotiate(payload));
+    result["last_event_seq"] = event_seq_id_.load() - 1;  // Resume point if nothing arrives before a dropout
+
+    return messages::createSuccessResponse(seq_id, "handshake", result);
+}
+
+json TCPServer::handleSystemGetStatus(const json& payload, int seq_id) {
+    (void)payload; // Suppress unused parameter warning
+
+    // The broadcaster's latest reading - no /proc access on this path
+    std::chrono::milliseconds age;
+    json result = SystemInfo::getSnapshot(age).toJson();
+    result["snapshot_age_ms"] = age.count();
+
+    return messages::createSuccessResponse(seq_id, "system.get_status", result);
+}
+
+void TCPServer::addMetricsSource(const std::string& name, std::function<json()> source) {
+    metrics_sources_.emplace_back(name, std::move(source));
+}
+
+json TCPServer::handleSystemGetMetrics(const json& payload, int seq_id) {
+    (void)payload;
+
+    // Commands that have not run yet are left out
+    json commands = json::object();
+    for (const auto& entry : metrics_) {
+        if (entry.second->total.count() > 0) {
+            commands[entry.first] = entry.second->toJson();
+        }
     }
 
-    json properties_array = parameters["properties"];
-    if (!properties_array.is_array()) {
-        return messages::createErrorResponse(
-            seq_id, "camera.get_properties",
-            messages::ErrorCode::INVALID_JSON,
-            "Parameter 'properties' must be an array"
-        );
+    json result = {
+        {"commands", commands},
+        {"server", stats_.toJson()}
+    };
+    for (const auto& source : metrics_sources_) {
+        result[source.first] = source.second();
     }
 
-    Logger::info("Executing camera.get_properties for " +
-                 std::to_string(properties_array.size()) + " properties");
+    return messages::createSuccessResponse(seq_id, "system.get_metrics", result);
+}
+
+json TCPServer::handleSystemRequestKeyframe(const json& payload, int seq_id) {
+    (void)payload;
 
-    // Get each property
-    json result = json::object();
-    for (const auto& prop : properties_array) {
-        std::string property = prop.get<std::string>();
-        std::string value = camera_->getProperty(property);
-        result[property] = value;
+    // A delta receiver that lost its keyframe resyncs on the next packet
+    if (udp_broadcaster_) {
+        udp_broadcaster_->requestKeyframe();
     }
 
-    return messages::createSuccessResponse(seq_id, "camera.get_properties", result);
+    return messages::createSuccessResponse(seq_id, "system.request_keyframe", json::object());
 }
 
 void TCPServer::sendNotification(messages::NotificationLevel level,
@@ -724,61 +1432,290 @@ void TCPServer::sendNotification(messages::NotificationLevel level,
                                  const std::string& message,
                                  const std::string& action,
                                  bool dismissible) {
-    // Create notification message
-    int seq_id = notification_seq_id_++;
-    json notification = messages::createNotificationMessage(
-        seq_id, level, category, title, message, action, dismissible
-    );
+    Logger::info("Broadcasting notification: " + title);
 
-    std::string notification_str = notification.dump() + "\n";
+    if (!running_) {
+        return;
+    }
 
-    Logger::info("Broadcasting notification: " + title);
+    // Client sockets belong to the event loop - queue the send there.
+    // Each encoding in use is serialized once and shared by its clients.
+    post([this, level, category, title, message, action, dismissible]() {
+        // Numbered on the loop, so sessions record them in order
+        int seq_id = event_seq_id_++;
+        auto notification = std::make_shared<const json>(messages::createNotificationMessage(
+            seq_id, level, category, title, message, action, dismissible
+        ));
+        for (auto& entry : sessions_) {
+            entry.second->record(seq_id, notification, config::SESSION_BACKLOG_SIZE);
+        }
 
-    // Send to all connected clients
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    for (int client_socket : active_clients_) {
-        ssize_t bytes_sent = send(client_socket, notification_str.c_str(),
-                                 notification_str.size(), MSG_DONTWAIT);
-        if (bytes_sent < 0) {
-            Logger::warning("Failed to send notification to client socket " +
-                          std::to_string(client_socket) + ": " +
-                          std::string(strerror(errno)));
+        std::string encoded[3];
+        for (auto& entry : connections_) {
+            ClientConnection& conn = *entry.second;
+            if (conn.resuming) {
+                continue;  // Replayed from its session's backlog, in order
+            }
+            std::string& frame = encoded[static_cast<int>(conn.encoding)];
+            if (frame.empty()) {
+                frame = wire::encode(*notification, conn.encoding);
+            }
+            queueOutput(conn, frame, Overflow::DROP);
         }
+    });
+}
+
+void TCPServer::publishPropertyChange(const std::string& property, const std::string& value) {
+    if (!running_) {
+        return;
+    }
+
+    // Status goes out sooner, and faster for a while
+    if (udp_broadcaster_) {
+        udp_broadcaster_->notifyActivity();
     }
+
+    post([this, property, value]() {
+        for (auto& entry : connections_) {
+            ClientConnection& conn = *entry.second;
+            if (conn.subscription.properties.count(property)) {
+                conn.subscription.pending_changes[property] = value;
+                property_events_pending_ = true;
+            }
+        }
+
+        // Clients that are away get the latest values when they resume
+        for (auto& entry : sessions_) {
+            Session& session = *entry.second;
+            if (!session.attached() && session.subscription.properties.count(property)) {
+                session.subscription.pending_changes[property] = value;
+            }
+        }
+    });
 }
 
-bool TCPServer::validateMessage(const json& msg, std::string& error) {
-    if (!msg.contains("protocol_version")) {
-        error = "Missing protocol_version";
+bool TCPServer::subscribeProperties(const std::vector<std::string>& properties, int min_interval_ms) {
+    CommandOrigin origin = current_origin;
+    if (origin.fd < 0) {
         return false;
     }
 
-    if (msg["protocol_version"] != config::PROTOCOL_VERSION) {
-        error = "Invalid protocol version: " + msg["protocol_version"].get<std::string>();
-        return false;
+    post([this, origin, properties, min_interval_ms]() {
+        auto it = connections_.find(origin.fd);
+        if (it == connections_.end() || it->second->id != origin.connection_id) {
+            return;  // Client went away
+        }
+
+        ClientConnection& conn = *it->second;
+        conn.subscription.properties = std::unordered_set<std::string>(properties.begin(), properties.end());
+        conn.subscription.interval = std::chrono::milliseconds(min_interval_ms);
+        conn.subscription.pending_changes = json::object();
+
+        Logger::info("Client " + conn.ip + " subscribed to " + std::to_string(properties.size()) +
+                     " camera properties (min interval " + std::to_string(min_interval_ms) + "ms)");
+    });
+    return true;
+}
+
+ResponseStream* TCPServer::openStream(const std::string& command, int seq_id, const json& info) {
+    CommandOrigin& origin = current_origin;
+    if (!origin.stream_window || !origin.spec || origin.spec->name != command || origin.seq_id != seq_id) {
+        return nullptr;  // Not asked for, not TCP, or a batch item
     }
 
-    if (!msg.contains("message_type")) {
-        error = "Missing message_type";
-        return false;
+    auto window = origin.stream_window;
+    auto send = [this, fd = origin.fd, id = origin.connection_id, window](std::string frame) {
+        post([this, fd, id, window, frame = std::move(frame)]() mutable {
+            queueStreamFrame(fd, id, *window, std::move(frame));
+        });
+    };
+
+    // The handler may run on the camera lane - waits happen in finish()
+    origin.stream = std::make_shared<ResponseStream>(seq_id, command, origin.encoding, window, std::move(send));
+    origin.stream->deferWaits();
+    origin.stream->begin(info);
+    stats_.responses_streamed++;
+    return origin.stream.get();
+}
+
+int TCPServer::flushPropertyEvents() {
+    if (!property_events_pending_) {
+        return -1;
     }
 
-    if (!msg.contains("sequence_id")) {
-        error = "Missing sequence_id";
-        return false;
+    auto now = std::chrono::steady_clock::now();
+    int timeout_ms = -1;
+    bool still_pending = false;
+
+    for (auto& entry : connections_) {
+        ClientConnection& conn = *entry.second;
+        PropertySubscription& subscription = conn.subscription;
+        if (subscription.pending_changes.empty()) {
+            continue;
+        }
+
+        auto due = subscription.last_event + subscription.interval;
+        if (now < due) {
+            // Rate limited - merged with anything newer and sent when due
+            int wait_ms = static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count()) + 1;
+            timeout_ms = timeout_ms < 0 ? wait_ms : std::min(timeout_ms, wait_ms);
+            still_pending = true;
+            continue;
+        }
+
+        int seq_id = event_seq_id_++;
+        auto event = std::make_shared<const json>(messages::createEventMessage(
+            seq_id, "camera.property_changed", {{"properties", subscription.pending_changes}}
+        ));
+        queueMessage(conn, *event, Overflow::DROP);
+        if (conn.session) {
+            conn.session->record(seq_id, event, config::SESSION_BACKLOG_SIZE);
+        }
+        subscription.pending_changes = json::object();
+        subscription.last_event = now;
     }
 
-    if (!msg.contains("payload")) {
-        error = "Missing payload";
-        return false;
+    property_events_pending_ = still_pending;
+    return timeout_ms;
+}
+
+void TCPServer::resumeSession(int fd, uint64_t connection_id, const std::string& client_id,
+                              bool resume, int last_seen) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end() || it->second->id != connection_id) {
+        return;  // Client went away before its handshake was answered
     }
+    ClientConnection& conn = *it->second;
+    conn.resuming = false;
+
+    auto found = sessions_.find(client_id);
+    bool existing = found != sessions_.end();
+    if (!existing) {
+        expireSessions(true);
+        found = sessions_.emplace(client_id, std::make_unique<Session>()).first;
+        found->second->client_id = client_id;
+    }
+    Session& session = *found->second;
 
-    // Special case: handshake messages don't need "command" field
-    std::string message_type = msg["message_type"].get<std::string>();
-    if (message_type != "handshake" && !msg["payload"].contains("command")) {
-        error = "Missing command in payload";
-        return false;
+    // A new session instance answers no retries from before it
+    if (!existing || !resume) {
+        session.cache_scope = client_id + '#' + std::to_string(++session_instances_);
     }
 
-    return true;
+    // Still held by an earlier connection the server has not seen drop
+    // (half-open link) - the resuming one takes over
+    if (session.attached() && session.fd != fd) {
+        auto previous = connections_.find(session.fd);
+        if (previous != connections_.end() && previous->second->id == session.connection_id) {
+            Logger::warning("Session " + client_id + " taken over from " + previous->second->ip +
+                            " by " + conn.ip);
+            previous->second->session = nullptr;
+            session.subscription = previous->second->subscription;
+        }
+    }
+    if (conn.session && conn.session != &session) {
+        detachSession(conn);  // Handshake again under another client_id
+    }
+    session.fd = fd;
+    session.connection_id = connection_id;
+    conn.session = &session;
+
+    if (!resume) {
+        // Starting over - nothing to catch up on
+        session.backlog.clear();
+        session.dropped_through = -1;
+        session.subscription = PropertySubscription();
+        Logger::info("Session " + client_id + (existing ? " restarted" : " started") + " on " + conn.ip);
+        return;
+    }
+
+    // An unknown session (e.g. the server restarted) cannot be caught up
+    std::vector<std::shared_ptr<const json>> missed;
+    bool complete = existing && session.replayAfter(last_seen, missed);
+    for (const auto& message : missed) {
+        queueMessage(conn, *message, Overflow::DROP);
+    }
+
+    // Property changes made while away go out, merged, as the next event
+    if (conn.subscription.properties.empty()) {
+        conn.subscription = std::move(session.subscription);
+        session.subscription = PropertySubscription();
+    }
+    if (!conn.subscription.pending_changes.empty()) {
+        property_events_pending_ = true;
+    }
+
+    Logger::info("Session " + client_id + " resumed on " + conn.ip + " from event " +
+                 std::to_string(last_seen) + ": " + std::to_string(missed.size()) + " replayed" +
+                 (complete ? "" : " (backlog incomplete - client must resync)"));
+    queueMessage(conn, messages::createEventMessage(event_seq_id_++, "session.resumed", {
+        {"resume_from", last_seen},
+        {"replayed", missed.size()},
+        {"complete", complete}
+    }));
+}
+
+void TCPServer::detachSession(ClientConnection& conn) {
+    Session* session = conn.session;
+    conn.session = nullptr;
+    if (!session || session->fd != conn.fd || session->connection_id != conn.id) {
+        return;
+    }
+
+    session->fd = -1;
+    session->connection_id = 0;
+    session->detached_at = std::chrono::steady_clock::now();
+    next_session_expiry_ = std::min(next_session_expiry_,
+                                    session->detached_at + std::chrono::seconds(config::SESSION_TTL_SEC));
+    session->subscription = std::move(conn.subscription);
+    Logger::debug("Session " + session->client_id + " detached - keeping its backlog");
 }
+
+void TCPServer::expireSessions(bool room_for_one) {
+    auto now = std::chrono::steady_clock::now();
+    auto ttl = std::chrono::seconds(config::SESSION_TTL_SEC);
+
+    auto oldest = sessions_.end();
+    auto next_oldest = sessions_.end();
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        Session& session = *it->second;
+        if (session.attached()) {
+            ++it;
+            continue;
+        }
+        if (now - session.detached_at >= ttl) {
+            Logger::debug("Session " + session.client_id + " expired");
+            it = sessions_.erase(it);
+            continue;
+        }
+        if (oldest == sessions_.end() || session.detached_at < oldest->second->detached_at) {
+            next_oldest = oldest;
+            oldest = it;
+        } else if (next_oldest == sessions_.end() || session.detached_at < next_oldest->second->detached_at) {
+            next_oldest = it;
+        }
+        ++it;
+    }
+
+    if (room_for_one && sessions_.size() >= config::MAX_SESSIONS && oldest != sessions_.end()) {
+        Logger::debug("Session " + oldest->second->client_id + " dropped (session table full)");
+        sessions_.erase(oldest);
+        oldest = next_oldest;
+    }
+
+    // The event loop wakes for the next one to expire
+    next_session_expiry_ = oldest != sessions_.end() ? oldest->second->detached_at + ttl :
+                                                       std::chrono::steady_clock::time_point::max();
+}
+
+bool TCPServer::clientIdInUse(const std::string& client_id, const ClientConnection& conn) const {
+    for (const auto& entry : connections_) {
+        const ClientConnection& other = *entry.second;
+        if (&other != &conn && !other.closing && other.client_id == client_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
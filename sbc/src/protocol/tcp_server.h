@@ -7,16 +7,41 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <deque>
+#include <chrono>
+#include <unordered_set>
 #include <nlohmann/json.hpp>
+#include <string_view>
+#include "config.h"
 #include "protocol/messages.h"
+#include "protocol/frame_reader.h"
+#include "protocol/wire_format.h"
+#include "protocol/command_registry.h"
+#include "protocol/command_dispatcher.h"
+#include "protocol/command_deadline.h"
+#include "protocol/command_coalescer.h"
+#include "protocol/command_header.h"
+#include "protocol/rate_limiter.h"
+#include "protocol/response_cache.h"
+#include "protocol/session.h"
+#include "protocol/server_stats.h"
+#include "protocol/command_metrics.h"
+#include "protocol/response_stream.h"
 
 using json = nlohmann::json;
 
 // Forward declarations
-class CameraInterface;
 class UDPBroadcaster;
 class Heartbeat;
 
+// TCP command server
+// A single event loop thread owns the listening socket and every client
+// socket (epoll, non-blocking I/O). Other threads hand work to the loop
+// through post(), which wakes it via an eventfd.
+// Commands run on a worker pool; responses are written as they complete
+// and may be out of order (clients correlate them by sequence_id).
 class TCPServer {
 public:
     explicit TCPServer(int port);
@@ -31,8 +56,8 @@ public:
     // Check if server is running
     bool isRunning() const { return running_; }
 
-    // Set camera interface
-    void setCamera(std::shared_ptr<CameraInterface> camera) { camera_ = camera; }
+    // Command table - command families register here before start()
+    CommandRegistry& commands() { return registry_; }
 
     // Set UDP broadcaster (for dynamic IP updates)
     void setUDPBroadcaster(UDPBroadcaster* broadcaster) { udp_broadcaster_ = broadcaster; }
@@ -40,7 +65,38 @@ public:
     // Set heartbeat handler (for dynamic IP updates)
     void setHeartbeat(Heartbeat* heartbeat) { heartbeat_ = heartbeat; }
 
-    // Send notification to all connected clients
+    // Also accept commands on a Unix domain socket at this path (call before
+    // start(); empty = TCP only). Local clients share the same dispatch.
+    void setLocalSocketPath(const std::string& path) { local_path_ = path; }
+
+    // Serve on listeners passed from the instance being replaced instead of
+    // binding (call before start(); -1 = open as usual)
+    void inheritSockets(int listener, int local_listener);
+
+    // Listeners to pass to a replacement (-1 if not open)
+    int listeningSocket() const { return server_socket_; }
+    int localListeningSocket() const { return local_socket_; }
+
+    // Stop accepting: the replacement holds the listeners now. Connected
+    // clients are served until stop(). Thread-safe.
+    void handOffListeners();
+
+    // Run a command that arrived on another transport (the UDP command
+    // channel). Same validation, rate limit and dispatch as a TCP command;
+    // the encoded JSON reply is passed to deliver - on a worker thread, or on
+    // the calling thread if the command is refused. Each budget must only be
+    // used from one thread.
+    void submitCommand(CommandHeader& header, CommandBudget& budget, const std::string& peer,
+                       std::function<void(std::string)> deliver);
+
+    // Server counters
+    const ServerStats& stats() const { return stats_; }
+
+    // Add a named section to the system.get_metrics result (call before
+    // start(); source runs on a worker thread)
+    void addMetricsSource(const std::string& name, std::function<json()> source);
+
+    // Send notification to all connected clients (thread-safe)
     void sendNotification(messages::NotificationLevel level,
                          messages::NotificationCategory category,
                          const std::string& title,
@@ -48,43 +104,221 @@ public:
                          const std::string& action = "",
                          bool dismissible = true);
 
+    // Push a camera property change to subscribed clients (thread-safe)
+    void publishPropertyChange(const std::string& property, const std::string& value);
+
+    // Subscribe the client whose command is running on the calling worker
+    // thread to property change events. Replaces any previous subscription;
+    // an empty list unsubscribes. Changes within min_interval_ms of the last
+    // event are merged into the next one. Returns false outside a command.
+    bool subscribeProperties(const std::vector<std::string>& properties, int min_interval_ms);
+
+    // Stream the result of the command running on the calling worker
+    // thread, if its client sent it with "stream": true over TCP. The
+    // handler adds the result to the stream as it is produced and returns
+    // json() - the stream never waits on a slow reader there. Once the
+    // handler returns, a general worker sends what the client was not ready
+    // for and the final response. Returns nullptr otherwise - answer with a
+    // normal response.
+    ResponseStream* openStream(const std::string& command, int seq_id,
+                               const json& info = json::object());
+
 private:
-    // Accept connections in a loop
-    void acceptLoop();
+    // Per-connection state, owned by the event loop thread
+    struct ClientConnection {
+        ClientConnection(int socket_fd, uint64_t connection_id, const std::string& client_ip)
+            : fd(socket_fd), id(connection_id), ip(client_ip), reader(config::TCP_MAX_FRAME_SIZE) {}
+
+        int fd;
+        uint64_t id;                // Unique per connection (fds are reused)
+        std::string ip;             // "local:<pid>" for Unix socket peers
+        bool local = false;         // Unix socket peer - not a MAX_TCP_CLIENTS slot
+        FrameReader reader;         // Inbound ring buffer and framing
+        wire::Encoding encoding = wire::Encoding::JSON;  // Negotiated in the handshake
+        std::deque<std::string> out_queue;  // Complete messages waiting for the socket
+        size_t out_offset = 0;      // Bytes of out_queue.front() already sent
+        size_t out_bytes = 0;       // Unsent bytes across out_queue
+        bool flush_pending = false; // Listed in pending_flush_
+        bool write_blocked = false; // Kernel buffer full - waiting for EPOLLOUT
+        uint32_t interest = 0;      // epoll events currently registered
+        int in_flight = 0;          // Commands dispatched but not yet answered
+        bool read_closed = false;   // Peer finished sending - close once answered
+        bool closing = false;       // I/O failed - close once the current event is handled
+        CommandBudget budget;       // Admission to the dispatcher
+        std::string client_id;      // From the handshake
+        Session* session = nullptr; // Attached once the handshake completes - scopes the response cache
+        bool resuming = false;      // Live notifications wait for the backlog replay
+        std::shared_ptr<StreamWindow> stream_window;  // Once the client asks for a streamed result
+
+        PropertySubscription subscription;
+    };
+
+    // Event loop (runs on loop_thread_)
+    void eventLoop();
+
+    // Accept all pending connections on the listening socket
+    void acceptConnections();
+
+    // Create, bind and listen on the TCP socket (throws on failure)
+    void openTcpSocket();
+
+    // Open the Unix domain socket listener (failure leaves TCP only)
+    void openLocalSocket();
+
+    // Accept pending local connections, checking each peer's credentials
+    void acceptLocalConnections();
+
+    // Register an accepted socket with the event loop
+    void addConnection(int fd, const std::string& peer, bool local);
+
+    // Read from a client and process any complete messages
+    void handleReadable(ClientConnection& conn);
+
+    // Dispatch buffered frames until none are left or the in-flight cap is hit
+    void processFrames(ClientConnection& conn);
+
+    // Flush queued output to a client (gathered into as few syscalls as possible)
+    void handleWritable(ClientConnection& conn);
+
+    // What to do when a message would push a client past TCP_MAX_OUTBOUND_BYTES
+    enum class Overflow {
+        DROP,        // Discard the message (notifications - the client can live without it)
+        DISCONNECT   // Close the client (responses - it would wait forever otherwise)
+    };
+
+    // Queue a complete message for a client; it is sent when the current
+    // event loop iteration flushes. Returns false if the message was not queued.
+    bool queueOutput(ClientConnection& conn, std::string data, Overflow policy = Overflow::DISCONNECT);
 
-    // Handle a single client connection
-    void handleClient(int client_socket, const std::string& client_ip);
+    // Encode a message in the client's negotiated encoding and queue it
+    bool queueMessage(ClientConnection& conn, const json& message, Overflow policy = Overflow::DISCONNECT);
 
-    // Process incoming command
-    json processCommand(const json& command);
+    // Flush every client that had output queued this iteration
+    void flushPendingOutput();
+
+    // Send property change events that are due
+    // Returns ms until the next held-back event is due, -1 if none
+    int flushPropertyEvents();
+
+    // Update the epoll interest set for a client
+    void updateInterest(ClientConnection& conn);
+
+    // Close a client connection and release its state
+    void closeConnection(int fd);
+
+    // Close connections marked as closing by posted tasks
+    void closeFailedConnections();
+
+    // Run a task on the event loop thread
+    void post(std::function<void()> task);
+
+    // Run tasks queued by post()
+    void runPostedTasks();
+
+    // Parse a single framed message and answer it or hand it to the workers
+    void handleMessage(ClientConnection& conn, std::string_view message);
+
+    // Validate a scanned message and look up its command, then take the
+    // payload for its handler from the header. Returns nullptr with
+    // error_response filled if it cannot be dispatched (including when it
+    // arrived past its deadline).
+    const CommandSpec* prepareCommand(CommandHeader& header, int& seq_id, json& payload,
+                                      json& error_response, bool& has_deadline,
+                                      deadline::Clock::time_point& deadline);
+
+    // Charge a command to the client's budget for its lane
+    // Returns false with error_response filled if it is over the limit
+    bool admitCommand(CommandBudget& budget, const CommandSpec& spec, const json& payload,
+                      int seq_id, const std::string& peer, json& error_response);
+
+    // Queue a prepared command on its lane. The response is encoded on the
+    // worker and handed to deliver there. fd/connection_id identify the
+    // issuing TCP connection (-1/0 for other transports); deliver also gets
+    // whether the command ran and succeeded; a superseded command hands its
+    // camera token back through refunds; stream_window is set if the client
+    // accepts a streamed result.
+    void dispatchCommand(const CommandSpec& spec, int seq_id, json payload, wire::Encoding reply_encoding,
+                         bool has_deadline, deadline::Clock::time_point deadline,
+                         int fd, uint64_t connection_id, const std::string& peer,
+                         std::function<void(std::string, bool)> deliver, CommandBudget::Refunds refunds,
+                         std::shared_ptr<StreamWindow> stream_window = nullptr);
+
+    // Run a command handler (worker thread)
+    // Expires the command instead if it waited in the queue past its deadline
+    json executeCommand(const CommandSpec& spec, const json& payload, int seq_id,
+                        bool has_deadline, deadline::Clock::time_point deadline);
+
+    // Deliver a completed command's response (event loop thread)
+    void completeCommand(int fd, uint64_t connection_id, const std::string& response);
+
+    // Queue a frame of a streamed response reserved in window (event loop thread)
+    void queueStreamFrame(int fd, uint64_t connection_id, StreamWindow& window, std::string frame);
+
+    // Attach a connection to its client's session once the handshake has
+    // been answered. With resume, replays what the client missed after
+    // last_seen (event sequence number) and restores its subscription.
+    void resumeSession(int fd, uint64_t connection_id, const std::string& client_id,
+                       bool resume, int last_seen);
+
+    // Park a closing connection's session (event loop thread)
+    void detachSession(ClientConnection& conn);
+
+    // Forget sessions detached longer than SESSION_TTL_SEC; with room_for_one,
+    // also the longest detached if the table is full
+    void expireSessions(bool room_for_one);
+
+    // Another live connection already identifies as client_id (event loop thread)
+    bool clientIdInUse(const std::string& client_id, const ClientConnection& conn) const;
 
     // Command handlers
     json handleHandshake(const json& payload, int seq_id);
     json handleSystemGetStatus(const json& payload, int seq_id);
-    json handleCameraCapture(const json& payload, int seq_id);
-    json handleCameraFocus(const json& payload, int seq_id);
-    json handleCameraAutoFocusHold(const json& payload, int seq_id);
-    json handleCameraSetProperty(const json& payload, int seq_id);
-    json handleCameraGetProperties(const json& payload, int seq_id);
-
-    // Validate message
-    bool validateMessage(const json& msg, std::string& error);
+    json handleSystemGetMetrics(const json& payload, int seq_id);
+    json handleSystemRequestKeyframe(const json& payload, int seq_id);
 
     int server_socket_;
+    int local_socket_ = -1;
+    std::string local_path_;
+    std::atomic<bool> listeners_handed_off_{false};
+    int local_clients_ = 0;     // Event loop thread only
+    int epoll_fd_;
+    int wake_fd_;
     int port_;
     std::atomic<bool> running_;
-    std::thread accept_thread_;
-    std::vector<std::thread> client_threads_;
-    std::shared_ptr<CameraInterface> camera_;
+    std::thread loop_thread_;
+    CommandRegistry registry_;
+    CommandDispatcher dispatcher_;
+    CommandCoalescer coalescer_;
+    ResponseCache response_cache_;
+    uint64_t next_connection_id_;
 
     // UDP broadcasters (for dynamic IP updates)
     UDPBroadcaster* udp_broadcaster_;
     Heartbeat* heartbeat_;
 
-    // Client tracking for notifications
-    std::mutex clients_mutex_;
-    std::vector<int> active_clients_;
-    std::atomic<int> notification_seq_id_{0};
+    // Client connections and sessions (event loop thread only)
+    std::unordered_map<int, std::unique_ptr<ClientConnection>> connections_;
+    std::vector<int> pending_flush_;
+    std::unordered_map<std::string, std::unique_ptr<Session>> sessions_;
+    uint64_t session_instances_ = 0;  // Numbers each session (re)start
+    std::chrono::steady_clock::time_point next_session_expiry_ =
+        std::chrono::steady_clock::time_point::max();  // Earliest detached session TTL
+
+    // Tasks posted from other threads
+    std::mutex post_mutex_;
+    std::vector<std::function<void()>> posted_tasks_;
+
+    std::atomic<int> event_seq_id_{0};      // Notifications and events share one sequence
+    bool property_events_pending_ = false;  // Some client has held-back changes
+
+    ServerStats stats_;
+
+    // Per-command latencies, one entry per registered command. Built by
+    // start() and never changed after, so workers look up without locking.
+    std::unordered_map<std::string, std::unique_ptr<CommandMetrics>> metrics_;
+    std::vector<std::pair<std::string, std::function<json()>>> metrics_sources_;
+
+    json handshake_result_;  // Fixed part of the handshake result, built by start()
 };
 
 #endif // TCP_SERVER_H
@@ -3,6 +3,7 @@
 #include "protocol/messages.h"
 #include "utils/logger.h"
 #include "utils/system_info.h"
+#include "protocol/heartbeat.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -11,17 +12,58 @@
 #include <errno.h>
 #include <chrono>
 #include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+// Leaves of from that differ in to, as index/value pairs (leaves numbered
+// depth-first in serialized order; an empty object is a leaf). False if
+// the two differ in shape - members added, removed or renamed - which only
+// a keyframe can carry.
+bool diffLeaves(const json& from, const json& to, size_t& index, json& changes) {
+    bool from_branch = from.is_object() && !from.empty();
+    bool to_branch = to.is_object() && !to.empty();
+    if (from_branch != to_branch) {
+        return false;
+    }
+
+    if (!from_branch) {
+        if (from != to) {
+            changes.push_back(index);
+            changes.push_back(to);
+        }
+        ++index;
+        return true;
+    }
+
+    if (from.size() != to.size()) {
+        return false;
+    }
+    for (auto a = from.begin(), b = to.begin(); a != from.end(); ++a, ++b) {
+        if (a.key() != b.key() || !diffLeaves(*a, *b, index, changes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
 
 UDPBroadcaster::UDPBroadcaster(int port, const std::string& default_target_ip)
     : socket_fd_(-1)
     , port_(port)
+    , destinations_version_(0)
     , default_target_ip_(default_target_ip)
     , running_(false)
     , sequence_id_(0)
     , camera_(nullptr)
+    , interval_ms_(config::STATUS_INTERVAL_MS)
+    , send_version_(0)
 {
     // Add default target to client list
     client_ips_.insert(default_target_ip);
+    rebuildDestinations();
 }
 
 UDPBroadcaster::~UDPBroadcaster() {
@@ -41,21 +83,82 @@ void UDPBroadcaster::addClient(const std::string& client_ip) {
     std::lock_guard<std::mutex> lock(clients_mutex_);
     if (client_ips_.insert(client_ip).second) {
         Logger::info("UDP broadcaster: Added client " + client_ip + " (total clients: " + std::to_string(client_ips_.size()) + ")");
+        rebuildDestinations();
     }
 }
 
 void UDPBroadcaster::removeClient(const std::string& client_ip) {
     std::lock_guard<std::mutex> lock(clients_mutex_);
+    delta_clients_.erase(client_ip);
     if (client_ips_.erase(client_ip) > 0) {
         Logger::info("UDP broadcaster: Removed client " + client_ip + " (remaining clients: " + std::to_string(client_ips_.size()) + ")");
+        rebuildDestinations();
+    }
+}
+
+void UDPBroadcaster::setClientDeltaStatus(const std::string& client_ip, bool delta) {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    bool changed = delta ? delta_clients_.insert(client_ip).second : delta_clients_.erase(client_ip) > 0;
+    if (changed) {
+        Logger::info("UDP broadcaster: " + client_ip + (delta ? " gets the delta status stream" : " gets full status"));
+        rebuildDestinations();
+        // A new delta receiver needs a keyframe to apply anything
+        if (delta) {
+            requestKeyframe();
+        }
     }
 }
 
+void UDPBroadcaster::rebuildDestinations() {
+    destinations_.clear();
+    for (const auto& client_ip : client_ips_) {
+        Destination destination{};
+        destination.addr.sin_family = AF_INET;
+        destination.delta = delta_clients_.count(client_ip) > 0;
+        if (inet_pton(AF_INET, client_ip.c_str(), &destination.addr.sin_addr) != 1) {
+            Logger::warning("UDP broadcaster: Not an IPv4 address, skipping: " + client_ip);
+            continue;
+        }
+
+        // Primary port, and the alternative for Windows Tools with firewall restrictions
+        destination.addr.sin_port = htons(port_);
+        destinations_.push_back(destination);
+        destination.addr.sin_port = htons(config::UDP_STATUS_PORT_ALT);
+        destinations_.push_back(destination);
+    }
+    destinations_version_++;
+}
+
 size_t UDPBroadcaster::getClientCount() const {
     std::lock_guard<std::mutex> lock(clients_mutex_);
     return client_ips_.size();
 }
 
+json UDPBroadcaster::stats() const {
+    json result = {
+        {"broadcasts", broadcasts_.load()},
+        {"datagrams_sent", datagrams_sent_.load()},
+        {"send_calls", send_calls_.load()},
+        {"send_errors", send_errors_.load()},
+        {"behind_schedule", behind_schedule_.load()},
+        {"interval_ms", interval_ms_.load()},
+        {"keyframes", keyframes_.load()},
+        {"deltas", deltas_.load()},
+        {"last_status_bytes", last_status_bytes_.load()},
+        {"last_delta_bytes", last_delta_bytes_.load()},
+        {"jitter_ms", jitter_.summaryMs()}
+    };
+    if (heartbeat_) {
+        LinkHealth health = heartbeat_->getLinkHealth();
+        result["link"] = {
+            {"heard", health.heard},
+            {"loss", health.loss},
+            {"rtt_ms", health.rtt_ms}
+        };
+    }
+    return result;
+}
+
 void UDPBroadcaster::start() {
     if (running_) {
         Logger::warning("UDP broadcaster already running");
@@ -70,7 +173,8 @@ void UDPBroadcaster::start() {
     }
 
     running_ = true;
-    Logger::info("UDP broadcaster started (default target: " + default_target_ip_ + ":" + std::to_string(port_) + " at 5 Hz)");
+    Logger::info("UDP broadcaster started (default target: " + default_target_ip_ + ":" + std::to_string(port_) +
+                 ", every " + std::to_string(config::STATUS_INTERVAL_MS) + " ms, adaptive)");
 
     // Start broadcast thread
     broadcast_thread_ = std::thread(&UDPBroadcaster::broadcastLoop, this);
@@ -82,7 +186,11 @@ void UDPBroadcaster::stop() {
     }
 
     Logger::info("Stopping UDP broadcaster...");
-    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
 
     // Wait for broadcast thread
     if (broadcast_thread_.joinable()) {
@@ -98,32 +206,111 @@ void UDPBroadcaster::stop() {
     Logger::info("UDP broadcaster stopped");
 }
 
+void UDPBroadcaster::requestKeyframe() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        keyframe_requested_ = true;
+    }
+    wake_.notify_all();
+}
+
+void UDPBroadcaster::notifyActivity() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        activity_ = true;
+    }
+    wake_.notify_all();
+}
+
 void UDPBroadcaster::broadcastLoop() {
     Logger::debug("UDP broadcast loop started");
 
     auto next_broadcast = std::chrono::steady_clock::now();
 
     while (running_) {
+        // How late this tick started (wakeup overshoot, or a slow last tick)
+        auto started = std::chrono::steady_clock::now();
+        if (started > next_broadcast) {
+            jitter_.record(started - next_broadcast);
+        } else {
+            jitter_.recordMicros(0);
+        }
+
         // Send status
         sendStatus();
 
-        // Calculate next broadcast time (5 Hz = 200ms interval)
-        next_broadcast += std::chrono::milliseconds(config::STATUS_INTERVAL_MS);
+        // Calculate next broadcast time (the interval sendStatus() announced)
+        next_broadcast += std::chrono::milliseconds(interval_ms_.load());
 
-        // Sleep until next broadcast
         auto now = std::chrono::steady_clock::now();
-        if (next_broadcast > now) {
-            std::this_thread::sleep_until(next_broadcast);
-        } else {
+        if (next_broadcast <= now) {
             // We're behind schedule, log warning
             Logger::warning("UDP broadcast falling behind schedule");
+            behind_schedule_++;
             next_broadcast = now;
         }
+
+        // Sleep until next broadcast. Activity or a keyframe request brings
+        // it forward, but no closer to this one than the active interval.
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        while (running_ && std::chrono::steady_clock::now() < next_broadcast) {
+            if (activity_ || keyframe_requested_) {
+                auto woken = std::chrono::steady_clock::now();
+                if (activity_) {
+                    activity_ = false;
+                    last_change_ = woken;
+                }
+                auto soonest = started + std::chrono::milliseconds(config::STATUS_INTERVAL_ACTIVE_MS);
+                next_broadcast = std::min(next_broadcast, std::max(woken, soonest));
+            }
+            wake_.wait_until(lock, next_broadcast);
+        }
     }
 
     Logger::debug("UDP broadcast loop ended");
 }
 
+int UDPBroadcaster::chooseInterval(std::chrono::steady_clock::time_point now, json& rate) {
+    int interval = config::STATUS_INTERVAL_MS;
+    const char* mode = "normal";
+    auto still = now - last_change_;
+    if (still < std::chrono::milliseconds(config::STATUS_ACTIVE_HOLD_MS)) {
+        interval = config::STATUS_INTERVAL_ACTIVE_MS;
+        mode = "active";
+    } else if (still >= std::chrono::milliseconds(config::STATUS_IDLE_AFTER_MS)) {
+        interval = config::STATUS_INTERVAL_IDLE_MS;
+        mode = "idle";
+    }
+
+    // Back off while the radio is struggling - more status would only add to it
+    const char* link = "unknown";
+    if (heartbeat_) {
+        LinkHealth health = heartbeat_->getLinkHealth();
+        if (!health.ever_heard) {
+            // Ground may not send heartbeats yet - nothing to back off from
+        } else if (!health.heard) {
+            interval *= 4;
+            link = "lost";
+        } else if (health.loss >= config::LINK_LOSS_POOR || health.rtt_ms >= config::LINK_RTT_POOR_MS) {
+            interval *= 4;
+            link = "poor";
+        } else if (health.loss >= config::LINK_LOSS_DEGRADED || health.rtt_ms >= config::LINK_RTT_DEGRADED_MS) {
+            interval *= 2;
+            link = "degraded";
+        } else {
+            link = "ok";
+        }
+    }
+    interval = std::min(interval, config::STATUS_INTERVAL_MAX_MS);
+
+    rate = {
+        {"interval_ms", interval},
+        {"mode", mode},
+        {"link", link}
+    };
+    return interval;
+}
+
 void UDPBroadcaster::sendStatus() {
     try {
         // Gather system status
@@ -145,68 +332,117 @@ void UDPBroadcaster::sendStatus() {
         messages::GimbalStatus gimbal;
         gimbal.connected = false;
 
+        // Any camera change (settings, shots taken) speeds the rate up
+        auto now = std::chrono::steady_clock::now();
+        json camera_json = camera.toJson();
+        if (camera_json != last_camera_) {
+            last_camera_ = std::move(camera_json);
+            last_change_ = now;
+        }
+        json rate;
+        int interval = chooseInterval(now, rate);
+        if (interval != interval_ms_) {
+            Logger::debug("UDP status interval " + std::to_string(interval) + " ms (" + rate.dump() + ")");
+        }
+        interval_ms_ = interval;
+
         // Create status message
+        int seq_id = sequence_id_++;
         json status_msg = messages::createStatusMessage(
-            sequence_id_++,
+            seq_id,
             system,
             camera,
             gimbal
         );
+        status_msg["payload"]["broadcast"] = rate;  // When to expect the next one
 
-        // Send to all registered clients
+        // Serialized once for every destination
         std::string message_str = status_msg.dump();
+        last_status_bytes_ = message_str.size();
 
-        // Get client IPs (thread-safe)
-        std::set<std::string> clients;
-        {
+        // Pick up client changes (rare) without locking on every tick
+        uint64_t version = destinations_version_.load();
+        if (version != send_version_) {
             std::lock_guard<std::mutex> lock(clients_mutex_);
-            clients = client_ips_;  // Copy the set
+            send_destinations_ = destinations_;
+            send_version_ = destinations_version_.load();
+
+            // One datagram per destination, sharing the full status or delta buffer
+            send_deltas_ = false;
+            send_msgs_.assign(send_destinations_.size(), mmsghdr{});
+            for (size_t i = 0; i < send_msgs_.size(); ++i) {
+                send_msgs_[i].msg_hdr.msg_name = &send_destinations_[i].addr;
+                send_msgs_[i].msg_hdr.msg_namelen = sizeof(send_destinations_[i].addr);
+                send_msgs_[i].msg_hdr.msg_iov = &send_iov_[send_destinations_[i].delta ? 1 : 0];
+                send_msgs_[i].msg_hdr.msg_iovlen = 1;
+                send_deltas_ = send_deltas_ || send_destinations_[i].delta;
+            }
+        }
+        broadcasts_++;
+        // Met by this packet whatever it is - all receivers get full status
+        // unless some want deltas
+        bool keyframe_requested = keyframe_requested_.exchange(false);
+        if (send_destinations_.empty()) {
+            return;
         }
 
-        // Send to each client
-        for (const auto& client_ip : clients) {
-            // Send to primary port
-            struct sockaddr_in target_addr{};
-            target_addr.sin_family = AF_INET;
-            target_addr.sin_port = htons(port_);
-            inet_pton(AF_INET, client_ip.c_str(), &target_addr.sin_addr);
-
-            ssize_t bytes_sent = sendto(
-                socket_fd_,
-                message_str.c_str(),
-                message_str.size(),
-                0,
-                (struct sockaddr*)&target_addr,
-                sizeof(target_addr)
-            );
-
-            if (bytes_sent < 0) {
-                Logger::error("Failed to send UDP status to " + client_ip + ":" + std::to_string(port_) + ": " + std::string(strerror(errno)));
+        // Delta stream: a keyframe every STATUS_KEYFRAME_INTERVAL_MS or on
+        // request, otherwise what changed since the last keyframe
+        std::string delta_str;
+        if (send_deltas_) {
+            bool keyframe = keyframe_requested || keyframe_seq_ < 0 ||
+                            now - keyframe_time_ >= std::chrono::milliseconds(config::STATUS_KEYFRAME_INTERVAL_MS);
+            if (!keyframe) {
+                size_t index = 0;
+                json changes = json::array();
+                if (diffLeaves(keyframe_payload_, status_msg["payload"], index, changes)) {
+                    delta_str = messages::createStatusDeltaMessage(seq_id, keyframe_seq_, changes).dump();
+                }
+                // Changed shape, or drifted so far that a keyframe is no bigger
+                keyframe = delta_str.empty() || delta_str.size() >= message_str.size();
+            }
+            if (keyframe) {
+                keyframe_payload_ = status_msg["payload"];
+                keyframe_seq_ = seq_id;
+                keyframe_time_ = now;
+                delta_str = message_str;
+                keyframes_++;
             } else {
-                Logger::debug("Sent UDP status to " + client_ip + ":" + std::to_string(port_) + " (seq=" + std::to_string(sequence_id_ - 1) + ", bytes=" + std::to_string(bytes_sent) + ")");
+                last_delta_bytes_ = delta_str.size();
+                deltas_++;
             }
+        } else {
+            keyframe_seq_ = -1;  // The next delta receiver starts from a keyframe
+        }
 
-            // Send to alternative port (for Windows Tools with firewall restrictions)
-            struct sockaddr_in target_addr_alt{};
-            target_addr_alt.sin_family = AF_INET;
-            target_addr_alt.sin_port = htons(config::UDP_STATUS_PORT_ALT);
-            inet_pton(AF_INET, client_ip.c_str(), &target_addr_alt.sin_addr);
-
-            ssize_t bytes_sent_alt = sendto(
-                socket_fd_,
-                message_str.c_str(),
-                message_str.size(),
-                0,
-                (struct sockaddr*)&target_addr_alt,
-                sizeof(target_addr_alt)
-            );
-
-            if (bytes_sent_alt < 0) {
-                Logger::error("Failed to send UDP status to " + client_ip + ":" + std::to_string(config::UDP_STATUS_PORT_ALT) + ": " + std::string(strerror(errno)));
-            } else {
-                Logger::debug("Sent UDP status to " + client_ip + ":" + std::to_string(config::UDP_STATUS_PORT_ALT) + " (seq=" + std::to_string(sequence_id_ - 1) + ", bytes=" + std::to_string(bytes_sent_alt) + ")");
+        size_t count = send_msgs_.size();
+        send_iov_[0].iov_base = const_cast<char*>(message_str.data());
+        send_iov_[0].iov_len = message_str.size();
+        send_iov_[1].iov_base = const_cast<char*>(delta_str.data());
+        send_iov_[1].iov_len = delta_str.size();
+
+        // sendmmsg() stops at the first failing destination - report it
+        // and carry on with the rest
+        size_t done = 0;
+        while (done < count) {
+            int sent = sendmmsg(socket_fd_, &send_msgs_[done], static_cast<unsigned int>(count - done), 0);
+            send_calls_++;
+            if (sent < 0) {
+                char ip[INET_ADDRSTRLEN] = "?";
+                inet_ntop(AF_INET, &send_destinations_[done].addr.sin_addr, ip, sizeof(ip));
+                Logger::error("Failed to send UDP status to " + std::string(ip) + ":" +
+                              std::to_string(ntohs(send_destinations_[done].addr.sin_port)) + ": " +
+                              std::string(strerror(errno)));
+                send_errors_++;
+                done++;
+                continue;
             }
+            done += static_cast<size_t>(sent);
+            datagrams_sent_ += static_cast<uint64_t>(sent);
         }
+
+        Logger::debug("Sent UDP status to " + std::to_string(count) + " destinations (seq=" +
+                      std::to_string(seq_id) + ", bytes=" + std::to_string(message_str.size()) + ")");
     } catch (const std::exception& e) {
         Logger::error("Exception in sendStatus: " + std::string(e.what()));
     }
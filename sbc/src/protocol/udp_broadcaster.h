@@ -6,8 +6,37 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <set>
+#include <vector>
+#include <cstdint>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <nlohmann/json.hpp>
 #include "camera/camera_interface.h"
+#include "utils/latency_histogram.h"
+
+using json = nlohmann::json;
+
+class Heartbeat;
+
+// Status broadcast to every known ground station
+// The rate adapts: STATUS_INTERVAL_ACTIVE_MS while camera status is
+// changing, STATUS_INTERVAL_MS normally, STATUS_INTERVAL_IDLE_MS once it has
+// been still for STATUS_IDLE_AFTER_MS, each stretched when the heartbeats
+// show loss or a slow round trip. Every status carries the interval until
+// the next one (payload.broadcast).
+//
+// Each tick serializes the status once and sends it to every destination
+// (each client on the primary and alternate port) with one sendmmsg().
+// The destination table is resolved when clients change, not per tick.
+//
+// Clients that ask for the delta status stream get a keyframe (the full
+// status message) every STATUS_KEYFRAME_INTERVAL_MS and, in between,
+// status_delta messages carrying only the values that differ from that
+// keyframe, addressed by position and without the message envelope - so
+// any delta can be applied as long as its keyframe arrived.
 
 class UDPBroadcaster {
 public:
@@ -17,6 +46,9 @@ public:
     // Set camera interface
     void setCamera(std::shared_ptr<CameraInterface> camera);
 
+    // Heartbeat handler whose link health slows the rate (call before start())
+    void setHeartbeat(Heartbeat* heartbeat) { heartbeat_ = heartbeat; }
+
     // Start broadcasting
     void start();
 
@@ -35,9 +67,23 @@ public:
     // Remove a client from receiving broadcasts (thread-safe)
     void removeClient(const std::string& client_ip);
 
+    // Send a client the delta status stream instead of full status (thread-safe)
+    void setClientDeltaStatus(const std::string& client_ip, bool delta);
+
+    // Make the next packet a keyframe, e.g. for a receiver that lost one,
+    // and send it soon rather than at a slow rate's next tick (thread-safe)
+    void requestKeyframe();
+
+    // Camera state just changed (e.g. a property was set): send status soon
+    // and switch to the active rate (thread-safe)
+    void notifyActivity();
+
     // Get number of registered clients
     size_t getClientCount() const;
 
+    // Broadcast counters and schedule jitter (how late each tick started)
+    json stats() const;
+
 private:
     // Broadcast loop
     void broadcastLoop();
@@ -45,15 +91,67 @@ private:
     // Gather and send status
     void sendStatus();
 
+    // Interval until the next status, from how recently camera status
+    // changed and the heartbeat link health; rate describes it for the payload
+    int chooseInterval(std::chrono::steady_clock::time_point now, json& rate);
+
+    // Resolve client_ips_ into destinations_ (clients_mutex_ held)
+    void rebuildDestinations();
+
+    struct Destination {
+        sockaddr_in addr;
+        bool delta;  // Delta status stream
+    };
+
     int socket_fd_;
     int port_;
     std::set<std::string> client_ips_;  // Multiple client IPs
+    std::set<std::string> delta_clients_;         // ...of which want the delta stream
+    std::vector<Destination> destinations_;       // Primary and alt port per client
+    std::atomic<uint64_t> destinations_version_;  // Bumped by rebuildDestinations()
     std::string default_target_ip_;      // Default/fallback target
     mutable std::mutex clients_mutex_;
     std::atomic<bool> running_;
     std::thread broadcast_thread_;
     int sequence_id_;
     std::shared_ptr<CameraInterface> camera_;
+    Heartbeat* heartbeat_ = nullptr;
+
+    // Wakes the broadcast loop early (stop, activity, keyframe request)
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool activity_ = false;  // wake_mutex_
+
+    // Adaptive rate (broadcast thread, but interval_ms_ is read by stats())
+    json last_camera_;
+    std::chrono::steady_clock::time_point last_change_;
+    std::atomic<int> interval_ms_;
+
+    // Broadcast thread's copy of destinations_, refreshed when the version
+    // moves, and the sendmmsg() headers pointing into it
+    std::vector<Destination> send_destinations_;
+    std::vector<mmsghdr> send_msgs_;
+    struct iovec send_iov_[2]{};  // The current tick's full status and delta
+    uint64_t send_version_;
+    bool send_deltas_ = false;    // Some destination wants the delta stream
+
+    // Delta stream state (broadcast thread)
+    json keyframe_payload_;       // What deltas are taken against
+    int keyframe_seq_ = -1;       // Its sequence_id; -1 = none yet
+    std::chrono::steady_clock::time_point keyframe_time_;
+    std::atomic<bool> keyframe_requested_{false};
+
+    // Counters
+    std::atomic<uint64_t> broadcasts_{0};
+    std::atomic<uint64_t> datagrams_sent_{0};
+    std::atomic<uint64_t> send_calls_{0};        // sendmmsg() calls - one per tick unless a send fails
+    std::atomic<uint64_t> send_errors_{0};
+    std::atomic<uint64_t> behind_schedule_{0};   // Ticks that started a whole interval late
+    std::atomic<uint64_t> keyframes_{0};         // Delta stream only
+    std::atomic<uint64_t> deltas_{0};
+    std::atomic<size_t> last_status_bytes_{0};
+    std::atomic<size_t> last_delta_bytes_{0};
+    LatencyHistogram jitter_;
 };
 
 #endif // UDP_BROADCASTER_H
@@ -0,0 +1,399 @@
+#include "protocol/udp_command_channel.h"
+#include "config.h"
+#include "protocol/messages.h"
+#include "protocol/command_header.h"
+#include "protocol/tcp_server.h"
+#include "utils/logger.h"
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cmath>
+#include <errno.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+void UDPCommandChannel::RttEstimator::sample(double rtt_ms) {
+    if (!has_sample) {
+        srtt_ms = rtt_ms;
+        rttvar_ms = rtt_ms / 2.0;
+        has_sample = true;
+        return;
+    }
+    rttvar_ms = 0.75 * rttvar_ms + 0.25 * std::fabs(srtt_ms - rtt_ms);
+    srtt_ms = 0.875 * srtt_ms + 0.125 * rtt_ms;
+}
+
+int UDPCommandChannel::RttEstimator::rtoMs() const {
+    if (!has_sample) {
+        return config::UDP_COMMAND_RTO_INITIAL_MS;
+    }
+    int rto = static_cast<int>(std::ceil(srtt_ms + std::max(1.0, 4.0 * rttvar_ms)));
+    return std::clamp(rto, config::UDP_COMMAND_RTO_MIN_MS, config::UDP_COMMAND_RTO_MAX_MS);
+}
+
+static std::string peerName(const sockaddr_in& addr) {
+    char ip[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+UDPCommandChannel::UDPCommandChannel(int port, TCPServer& server)
+    : socket_fd_(-1)
+    , wake_fd_(-1)
+    , port_(port)
+    , server_(server)
+    , running_(false)
+{
+}
+
+UDPCommandChannel::~UDPCommandChannel() {
+    stop();
+}
+
+void UDPCommandChannel::start() {
+    if (running_) {
+        Logger::warning("UDP command channel already running");
+        return;
+    }
+
+    // A replacement process starts on the socket of the one it replaces
+    if (socket_fd_ < 0) {
+        socket_fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (socket_fd_ < 0) {
+            Logger::error("Failed to create UDP command socket: " + std::string(strerror(errno)));
+            return;
+        }
+
+        struct sockaddr_in bind_addr{};
+        bind_addr.sin_family = AF_INET;
+        bind_addr.sin_addr.s_addr = INADDR_ANY;
+        bind_addr.sin_port = htons(port_);
+
+        if (bind(socket_fd_, (struct sockaddr*)&bind_addr, sizeof(bind_addr)) < 0) {
+            Logger::error("Failed to bind UDP command socket (port " + std::to_string(port_) + "): " +
+                          std::string(strerror(errno)) + " - UDP commands disabled");
+            close(socket_fd_);
+            socket_fd_ = -1;
+            return;
+        }
+    } else {
+        fcntl(socket_fd_, F_SETFL, fcntl(socket_fd_, F_GETFL) | O_NONBLOCK);
+        Logger::info("Using inherited UDP command socket");
+    }
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        Logger::error("Failed to create UDP command wakeup eventfd: " + std::string(strerror(errno)));
+        close(socket_fd_);
+        socket_fd_ = -1;
+        return;
+    }
+
+    running_ = true;
+    receive_thread_ = std::thread(&UDPCommandChannel::receiveLoop, this);
+
+    Logger::info("UDP command channel listening on port " + std::to_string(port_));
+}
+
+void UDPCommandChannel::stop() {
+    if (!running_) {
+        return;
+    }
+
+    Logger::info("Stopping UDP command channel...");
+    running_ = false;
+    wake();
+
+    if (receive_thread_.joinable()) {
+        receive_thread_.join();
+    }
+
+    // Workers may still be sending responses; they see an invalid fd and fail quietly
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        close(socket_fd_);
+        socket_fd_ = -1;
+        outstanding_.clear();
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+
+    Logger::info("UDP command channel stopped");
+}
+
+json UDPCommandChannel::stats() const {
+    size_t waiting = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        waiting = outstanding_.size();
+    }
+    return {
+        {"commands_received", commands_received_.load()},
+        {"duplicates", duplicates_.load()},
+        {"acks_received", acks_received_.load()},
+        {"retransmits", retransmits_.load()},
+        {"responses_abandoned", responses_abandoned_.load()},
+        {"responses_awaiting_ack", waiting},
+        {"peers_refused", peers_refused_.load()}
+    };
+}
+
+void UDPCommandChannel::receiveLoop() {
+    Logger::debug("UDP command receive loop started");
+
+    std::vector<char> buffer(config::TCP_MAX_FRAME_SIZE);
+    auto next_expiry = Clock::now();
+
+    while (running_) {
+        // Sleep until the next retransmit - or a datagram, or a worker
+        // adding a response that is due sooner
+        int timeout_ms = retransmitDue();
+
+        struct pollfd pfds[2] = {{socket_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+        int ready = poll(pfds, 2, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            Logger::error("UDP command poll failed: " + std::string(strerror(errno)));
+            break;
+        }
+
+        if (ready > 0 && (pfds[1].revents & POLLIN)) {
+            uint64_t count;
+            while (read(wake_fd_, &count, sizeof(count)) > 0) {}
+        }
+
+        while (ready > 0 && (pfds[0].revents & POLLIN)) {
+            struct sockaddr_in sender_addr{};
+            socklen_t sender_addr_len = sizeof(sender_addr);
+
+            // MSG_TRUNC reports the datagram's real length
+            ssize_t bytes_received = recvfrom(socket_fd_, buffer.data(), buffer.size(), MSG_TRUNC,
+                                              (struct sockaddr*)&sender_addr, &sender_addr_len);
+            if (bytes_received < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    Logger::error("Failed to receive UDP command: " + std::string(strerror(errno)));
+                }
+                break;
+            }
+
+            if (static_cast<size_t>(bytes_received) > buffer.size()) {
+                Logger::warning("Dropped " + std::to_string(bytes_received) + "-byte UDP command from " +
+                                peerName(sender_addr) + " (max " + std::to_string(buffer.size()) + ")");
+                continue;
+            }
+
+            handleDatagram(sender_addr, std::string_view(buffer.data(), bytes_received));
+        }
+
+        auto now = Clock::now();
+        if (now >= next_expiry) {
+            expireSeen(now);
+            next_expiry = now + std::chrono::seconds(1);
+        }
+    }
+
+    Logger::debug("UDP command receive loop ended");
+}
+
+void UDPCommandChannel::handleDatagram(const sockaddr_in& from, std::string_view data) {
+    std::string peer_name = peerName(from);
+
+    CommandHeader header;
+    std::string parse_error;
+    if (!scanCommandHeader(data, wire::Encoding::JSON, header, parse_error)) {
+        Logger::warning("JSON parse error from " + peer_name + " (UDP): " + parse_error);
+        sendTo(from, messages::createErrorResponse(
+            0, "unknown", messages::ErrorCode::INVALID_JSON, "Invalid JSON: " + parse_error
+        ).dump());
+        return;
+    }
+
+    // The ground acknowledging one of our responses
+    if (header.message_type == "ack") {
+        if (!header.sequence_id_valid) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = outstanding_.find({peer_name, header.sequence_id});
+        if (it == outstanding_.end()) {
+            return;  // Already acked, or given up
+        }
+        // Only responses sent once give an unambiguous round trip (Karn)
+        if (it->second.transmissions == 1) {
+            rtt_[peer_name].sample(std::chrono::duration<double, std::milli>(
+                Clock::now() - it->second.first_sent).count());
+        }
+        outstanding_.erase(it);
+        acks_received_++;
+        return;
+    }
+
+    // Without a usable sequence_id there is nothing to ack or dedupe by -
+    // the dispatch path reports the problem
+    if (!header.sequence_id_valid) {
+        CommandBudget budget;
+        server_.submitCommand(header, budget, peer_name, [this, from](std::string response) {
+            sendTo(from, response);
+        });
+        return;
+    }
+
+    auto now = Clock::now();
+    auto peer_it = peers_.find(peer_name);
+    if (peer_it == peers_.end()) {
+        if (peers_.size() >= static_cast<size_t>(config::UDP_COMMAND_MAX_PEERS)) {
+            expireSeen(now);
+        }
+        if (peers_.size() >= static_cast<size_t>(config::UDP_COMMAND_MAX_PEERS)) {
+            peers_refused_++;
+            Logger::warning("Ignored UDP command from " + peer_name + ": " +
+                            std::to_string(config::UDP_COMMAND_MAX_PEERS) + " peers already active");
+            return;
+        }
+        peer_it = peers_.emplace(peer_name, Peer{}).first;
+        peer_it->second.addr = from;
+        Logger::info("UDP command peer " + peer_name);
+    }
+
+    Peer& peer = peer_it->second;
+    peer.last_heard = now;
+    int seq_id = header.sequence_id;
+
+    // Ack receipt first so the ground stops retransmitting the command
+    sendTo(from, messages::createAckMessage(seq_id).dump());
+
+    if (peer.seen.count(seq_id) > 0) {
+        duplicates_++;
+
+        // The response (or our ack of the response) was lost - send it again now
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = outstanding_.find({peer_name, seq_id});
+        if (it != outstanding_.end()) {
+            it->second.transmissions++;
+            retransmits_++;
+            ::sendto(socket_fd_, it->second.data.data(), it->second.data.size(), 0,
+                     (const struct sockaddr*)&from, sizeof(from));
+        }
+        Logger::debug("Duplicate UDP command #" + std::to_string(seq_id) + " from " + peer_name);
+        return;
+    }
+
+    peer.seen[seq_id] = now;
+    peer.seen_order.emplace_back(seq_id, now);
+    commands_received_++;
+
+    Logger::debug("Received from " + peer_name + " (UDP): " + std::string(data));
+    server_.submitCommand(header, peer.budget, peer_name,
+                          [this, peer_name, from, seq_id](std::string response) {
+        deliver(peer_name, from, seq_id, std::move(response));
+    });
+}
+
+void UDPCommandChannel::deliver(const std::string& peer, const sockaddr_in& addr, int seq_id, std::string response) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_fd_ < 0) {
+        return;
+    }
+
+    auto now = Clock::now();
+    Outstanding& entry = outstanding_[{peer, seq_id}];
+    entry.addr = addr;
+    entry.data = std::move(response);
+    entry.first_sent = now;
+    entry.next_due = now + std::chrono::milliseconds(rtt_[peer].rtoMs());
+    entry.transmissions = 1;
+
+    ::sendto(socket_fd_, entry.data.data(), entry.data.size(), 0,
+             (const struct sockaddr*)&addr, sizeof(addr));
+
+    // The receive thread sleeps until wake_at_ - get it up for this one
+    if (entry.next_due < wake_at_) {
+        wake_at_ = entry.next_due;
+        wake();
+    }
+}
+
+void UDPCommandChannel::wake() {
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+int UDPCommandChannel::retransmitDue() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    int next_ms = -1;
+
+    for (auto it = outstanding_.begin(); it != outstanding_.end();) {
+        Outstanding& entry = it->second;
+        if (entry.next_due > now) {
+            int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                entry.next_due - now).count()) + 1;
+            next_ms = next_ms < 0 ? wait_ms : std::min(next_ms, wait_ms);
+            ++it;
+            continue;
+        }
+
+        if (entry.transmissions >= config::UDP_COMMAND_MAX_TRANSMISSIONS) {
+            responses_abandoned_++;
+            Logger::warning("Gave up on response #" + std::to_string(it->first.second) + " to " +
+                            it->first.first + " after " + std::to_string(entry.transmissions) + " sends");
+            it = outstanding_.erase(it);
+            continue;
+        }
+
+        ::sendto(socket_fd_, entry.data.data(), entry.data.size(), 0,
+                 (const struct sockaddr*)&entry.addr, sizeof(entry.addr));
+        entry.transmissions++;
+        retransmits_++;
+
+        // Back off: double the timeout on every retry
+        int rto_ms = rtt_[it->first.first].rtoMs();
+        int backoff_ms = std::min(rto_ms << std::min(entry.transmissions - 1, 6),
+                                  config::UDP_COMMAND_RTO_MAX_MS);
+        entry.next_due = now + std::chrono::milliseconds(backoff_ms);
+        next_ms = next_ms < 0 ? backoff_ms : std::min(next_ms, backoff_ms);
+        ++it;
+    }
+
+    wake_at_ = next_ms < 0 ? Clock::time_point::max() : now + std::chrono::milliseconds(next_ms);
+    return next_ms;
+}
+
+void UDPCommandChannel::expireSeen(Clock::time_point now) {
+    auto cutoff = now - std::chrono::seconds(config::UDP_COMMAND_DEDUPE_SEC);
+
+    for (auto it = peers_.begin(); it != peers_.end();) {
+        Peer& peer = it->second;
+        while (!peer.seen_order.empty() && peer.seen_order.front().second < cutoff) {
+            peer.seen.erase(peer.seen_order.front().first);
+            peer.seen_order.pop_front();
+        }
+
+        if (peer.last_heard < cutoff) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto first = outstanding_.lower_bound({it->first, std::numeric_limits<int>::min()});
+            if (first == outstanding_.end() || first->first.first != it->first) {
+                Logger::info("UDP command peer " + it->first + " idle - forgotten");
+                rtt_.erase(it->first);
+                it = peers_.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+}
+
+void UDPCommandChannel::sendTo(const sockaddr_in& addr, const std::string& data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_fd_ < 0) {
+        return;
+    }
+    if (::sendto(socket_fd_, data.data(), data.size(), 0, (const struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        Logger::debug("Failed to send UDP reply to " + peerName(addr) + ": " + std::string(strerror(errno)));
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef UDP_COMMAND_CHANNEL_H
+#define UDP_COMMAND_CHANNEL_H
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <map>
+#include <deque>
+#include <unordered_map>
+#include <netinet/in.h>
+#include <nlohmann/json.hpp>
+#include "protocol/rate_limiter.h"
+
+using json = nlohmann::json;
+
+class TCPServer;
+
+// Reliable UDP command channel
+// Commands arrive one JSON message per datagram and run through the same
+// dispatch as TCP commands. Over a lossy radio link a lost datagram only
+// delays its own command, never the ones behind it:
+//   - every command is acked as soon as it arrives, so the ground can stop
+//     retransmitting it; a retransmitted duplicate (same peer and
+//     sequence_id) is acked again but not run again
+//   - every response is retransmitted until the ground acks it, each on its
+//     own timer (RFC 6298 timeout from the peer's measured round trip,
+//     doubled on every retry)
+// One thread receives and retransmits; responses are sent from the workers,
+// which wake it through an eventfd when a response is due before it would
+// otherwise look.
+class UDPCommandChannel {
+public:
+    UDPCommandChannel(int port, TCPServer& server);
+    ~UDPCommandChannel();
+
+    // Start the channel (a port that cannot be bound leaves it off)
+    void start();
+
+    // Stop the channel
+    void stop();
+
+    // Check if running
+    bool isRunning() const { return running_; }
+
+    // Use a socket passed from the instance being replaced instead of
+    // binding (call before start())
+    void inheritSocket(int fd) { socket_fd_ = fd; }
+
+    // Socket to pass to a replacement (-1 if not open)
+    int socketFd() const { return socket_fd_; }
+
+    // Channel counters
+    json stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Smoothed round trip for one peer (RFC 6298)
+    struct RttEstimator {
+        double srtt_ms = 0.0;
+        double rttvar_ms = 0.0;
+        bool has_sample = false;
+
+        void sample(double rtt_ms);
+        int rtoMs() const;
+    };
+
+    // A ground station, receive thread only. Keyed by address and port, so a
+    // restarted app (new source port) starts a fresh sequence_id space.
+    struct Peer {
+        sockaddr_in addr{};
+        CommandBudget budget;
+        std::unordered_map<int, Clock::time_point> seen;     // sequence_id -> first received
+        std::deque<std::pair<int, Clock::time_point>> seen_order;
+        Clock::time_point last_heard;
+    };
+
+    // A response waiting for the peer's ack
+    struct Outstanding {
+        sockaddr_in addr{};
+        std::string data;
+        Clock::time_point first_sent;
+        Clock::time_point next_due;
+        int transmissions = 1;
+    };
+
+    // Receive datagrams and retransmit unacked responses
+    void receiveLoop();
+
+    // Handle one datagram from a peer
+    void handleDatagram(const sockaddr_in& from, std::string_view data);
+
+    // Send a command's response and track it until acked (any thread)
+    void deliver(const std::string& peer, const sockaddr_in& addr, int seq_id, std::string response);
+
+    // Retransmit responses whose timeout has passed
+    // Returns ms until the next one is due, -1 if none are waiting
+    int retransmitDue();
+
+    // Wake the receive thread (any thread)
+    void wake();
+
+    // Forget sequence_ids and idle peers older than UDP_COMMAND_DEDUPE_SEC
+    void expireSeen(Clock::time_point now);
+
+    // Send one datagram (any thread)
+    void sendTo(const sockaddr_in& addr, const std::string& data);
+
+    int socket_fd_;
+    int wake_fd_;
+    int port_;
+    TCPServer& server_;
+    std::atomic<bool> running_;
+    std::thread receive_thread_;
+
+    std::unordered_map<std::string, Peer> peers_;  // Receive thread only
+
+    // Responses in flight, keyed by peer and sequence_id, and each peer's
+    // round trip (workers add responses, the receive thread acks them)
+    mutable std::mutex mutex_;
+    std::map<std::pair<std::string, int>, Outstanding> outstanding_;
+    std::unordered_map<std::string, RttEstimator> rtt_;
+    Clock::time_point wake_at_ = Clock::time_point::max();  // Receive thread's next look
+
+    // Counters
+    std::atomic<uint64_t> commands_received_{0};
+    std::atomic<uint64_t> duplicates_{0};
+    std::atomic<uint64_t> acks_received_{0};
+    std::atomic<uint64_t> retransmits_{0};
+    std::atomic<uint64_t> responses_abandoned_{0};
+    std::atomic<uint64_t> peers_refused_{0};
+};
+
+#endif // UDP_COMMAND_CHANNEL_H
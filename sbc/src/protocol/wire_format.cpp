@@ -0,0 +1,107 @@
+#include "protocol/wire_format.h"
+#include <algorithm>
+
+namespace wire {
+
+const char* encodingToString(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::JSON:    return "json";
+        case Encoding::CBOR:    return "cbor";
+        case Encoding::MSGPACK: return "msgpack";
+        default:                return "json";
+    }
+}
+
+bool encodingFromString(const std::string& name, Encoding& encoding) {
+    if (name == "json") {
+        encoding = Encoding::JSON;
+    } else if (name == "cbor") {
+        encoding = Encoding::CBOR;
+    } else if (name == "msgpack") {
+        encoding = Encoding::MSGPACK;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> supportedEncodings() {
+    return {"json", "cbor", "msgpack"};
+}
+
+Encoding negotiate(const json& handshake_payload) {
+    // Same old/new handshake formats as client_id (direct fields or "parameters")
+    const json* requested = nullptr;
+    if (handshake_payload.contains("encodings")) {
+        requested = &handshake_payload["encodings"];
+    } else if (handshake_payload.contains("parameters") &&
+               handshake_payload["parameters"].is_object() &&
+               handshake_payload["parameters"].contains("encodings")) {
+        requested = &handshake_payload["parameters"]["encodings"];
+    }
+
+    if (requested == nullptr || !requested->is_array()) {
+        return Encoding::JSON;
+    }
+
+    // Client lists encodings in order of preference
+    for (const auto& name : *requested) {
+        Encoding encoding;
+        if (name.is_string() && encodingFromString(name.get<std::string>(), encoding)) {
+            return encoding;
+        }
+    }
+
+    return Encoding::JSON;
+}
+
+std::string encode(const json& message, Encoding encoding) {
+    if (encoding == Encoding::JSON) {
+        return message.dump() + "\n";
+    }
+
+    // Reserve the prefix, append the body, then fill in its length
+    std::string frame(LENGTH_PREFIX_SIZE, '\0');
+    if (encoding == Encoding::CBOR) {
+        json::to_cbor(message, frame);
+    } else {
+        json::to_msgpack(message, frame);
+    }
+
+    size_t length = frame.size() - LENGTH_PREFIX_SIZE;
+    frame[0] = static_cast<char>((length >> 24) & 0xFF);
+    frame[1] = static_cast<char>((length >> 16) & 0xFF);
+    frame[2] = static_cast<char>((length >> 8) & 0xFF);
+    frame[3] = static_cast<char>(length & 0xFF);
+
+    return frame;
+}
+
+json decode(std::string_view frame, Encoding encoding) {
+    switch (encoding) {
+        case Encoding::CBOR:
+            return json::from_cbor(frame.begin(), frame.end());
+        case Encoding::MSGPACK:
+            return json::from_msgpack(frame.begin(), frame.end());
+        case Encoding::JSON:
+        default:
+            return json::parse(frame.begin(), frame.end());
+    }
+}
+
+std::string transcode(const std::string& frame, Encoding from, Encoding to) {
+    if (from == to) {
+        return frame;
+    }
+
+    // Strip the framing encode() added
+    std::string_view body(frame);
+    if (isBinary(from)) {
+        body.remove_prefix(std::min(body.size(), LENGTH_PREFIX_SIZE));
+    } else if (!body.empty() && body.back() == '\n') {
+        body.remove_suffix(1);
+    }
+    return encode(decode(body, from), to);
+}
+
+} // namespace wire
@@ -0,0 +1,55 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Encodings for the TCP command channel
+// JSON is newline-delimited and always the default. The binary encodings
+// (negotiated in the handshake) carry the same message objects, each frame
+// prefixed with its length as a 4-byte big-endian integer.
+namespace wire {
+
+enum class Encoding {
+    JSON,
+    CBOR,
+    MSGPACK
+};
+
+// Size of the length prefix used by binary encodings
+constexpr size_t LENGTH_PREFIX_SIZE = 4;
+
+// Protocol name ("json", "cbor", "msgpack")
+const char* encodingToString(Encoding encoding);
+
+// Parse a protocol name; returns false if unsupported
+bool encodingFromString(const std::string& name, Encoding& encoding);
+
+// Names of every supported encoding (advertised in the handshake)
+std::vector<std::string> supportedEncodings();
+
+// Encoding requested by a handshake payload: the first entry of
+// "encodings" (top level or under "parameters") that we support, else JSON
+Encoding negotiate(const json& handshake_payload);
+
+// Whether frames of this encoding are length-prefixed
+inline bool isBinary(Encoding encoding) { return encoding != Encoding::JSON; }
+
+// Serialize a message as a complete frame, ready to send
+std::string encode(const json& message, Encoding encoding);
+
+// Parse one frame (without its newline or length prefix)
+// Throws json::exception on malformed input
+json decode(std::string_view frame, Encoding encoding);
+
+// Re-frame a complete frame (as produced by encode) in another encoding
+// Throws json::exception on malformed input
+std::string transcode(const std::string& frame, Encoding from, Encoding to);
+
+} // namespace wire
+
+#endif // WIRE_FORMAT_H
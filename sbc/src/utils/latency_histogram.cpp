@@ -0,0 +1,67 @@
+#include "utils/latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+int LatencyHistogram::bucketIndex(uint64_t micros) {
+    micros = std::min<uint64_t>(micros, (uint64_t(1) << MAX_BIT) - 1);
+    if (micros < 2 * SUB_BUCKETS) {
+        return static_cast<int>(micros);
+    }
+
+    // Top SUB_BUCKET_BITS + 1 significant bits select the bucket
+    int msb = 63 - __builtin_clzll(micros);
+    int shift = msb - SUB_BUCKET_BITS;
+    return static_cast<int>(shift * SUB_BUCKETS + (micros >> shift));
+}
+
+uint64_t LatencyHistogram::bucketUpperMicros(int index) {
+    if (index < static_cast<int>(2 * SUB_BUCKETS)) {
+        return static_cast<uint64_t>(index);
+    }
+
+    int shift = index / static_cast<int>(SUB_BUCKETS) - 1;
+    uint64_t sub = static_cast<uint64_t>(index) - static_cast<uint64_t>(shift) * SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration) {
+    recordMicros(static_cast<uint64_t>(std::max<int64_t>(0, duration.count() / 1000)));
+}
+
+void LatencyHistogram::recordMicros(uint64_t micros) {
+    buckets_[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (micros > seen && !max_.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentileMicros(double fraction) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total)));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucketUpperMicros(i), maxMicros());
+        }
+    }
+    return maxMicros();
+}
+
+json LatencyHistogram::summaryMs() const {
+    auto ms = [](uint64_t micros) { return std::round(static_cast<double>(micros) / 10.0) / 100.0; };
+    return {
+        {"p50", ms(percentileMicros(0.50))},
+        {"p90", ms(percentileMicros(0.90))},
+        {"p99", ms(percentileMicros(0.99))},
+        {"max", ms(maxMicros())}
+    };
+}
@@ -0,0 +1,46 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Latency histogram in microseconds, HDR style
+// Values below 32us get a bucket each; above that every power of two is
+// split into 16 buckets, so any recorded value is known to within ~6% up to
+// 2^40us (12 days). Recording is a few atomic adds (no locks), so it is safe
+// on the command path from any number of threads; reads are approximate
+// while recording continues.
+class LatencyHistogram {
+public:
+    void record(std::chrono::nanoseconds duration);
+    void recordMicros(uint64_t micros);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t maxMicros() const { return max_.load(std::memory_order_relaxed); }
+
+    // Value at or below which fraction (0-1) of the recorded values fall
+    // (upper edge of its bucket, never above the maximum)
+    uint64_t percentileMicros(double fraction) const;
+
+    // {"p50", "p90", "p99", "max"} in milliseconds
+    json summaryMs() const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr int MAX_BIT = 40;
+    static constexpr int BUCKET_COUNT = (MAX_BIT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static int bucketIndex(uint64_t micros);
+    static uint64_t bucketUpperMicros(int index);
+
+    std::atomic<uint64_t> buckets_[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -1,8 +1,10 @@
 #include "utils/system_info.h"
 #include "utils/logger.h"
+#include "config.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
 #include <sys/statvfs.h>
 #include <unistd.h>
 
@@ -11,26 +13,62 @@ SystemInfo::NetworkStats SystemInfo::last_network_stats_ = {0, 0, std::chrono::s
 bool SystemInfo::network_stats_initialized_ = false;
 SystemInfo::CPUStats SystemInfo::last_cpu_stats_ = {0, 0, std::chrono::steady_clock::now()};
 bool SystemInfo::cpu_stats_initialized_ = false;
+std::mutex SystemInfo::status_mutex_;
+std::mutex SystemInfo::snapshot_mutex_;
+messages::SystemStatus SystemInfo::snapshot_ = {};
+std::chrono::steady_clock::time_point SystemInfo::snapshot_time_;
+bool SystemInfo::snapshot_valid_ = false;
+
+// Rounded to what the reading is good for - spare digits would be sent in
+// every status packet
+static double roundTo(double value, int decimals) {
+    double scale = std::pow(10.0, decimals);
+    return std::round(value * scale) / scale;
+}
 
 messages::SystemStatus SystemInfo::getStatus() {
+    std::lock_guard<std::mutex> lock(status_mutex_);
     messages::SystemStatus status;
 
     try {
         status.uptime_seconds = getUptimeSeconds();
-        status.cpu_percent = getCPUPercent();
+        status.cpu_percent = roundTo(getCPUPercent(), 1);
         status.memory_mb = getMemoryUsedMB();
         status.memory_total_mb = getMemoryTotalMB();
-        status.disk_free_gb = getDiskFreeGB();
-        status.disk_total_gb = getDiskTotalGB();
-        status.network_rx_mbps = getNetworkRxMbps();
-        status.network_tx_mbps = getNetworkTxMbps();
+        status.disk_free_gb = roundTo(getDiskFreeGB(), 2);
+        status.disk_total_gb = roundTo(getDiskTotalGB(), 2);
+        status.network_rx_mbps = roundTo(getNetworkRxMbps(), 2);
+        status.network_tx_mbps = roundTo(getNetworkTxMbps(), 2);
     } catch (const std::exception& e) {
         Logger::error("Failed to get system status: " + std::string(e.what()));
     }
 
+    {
+        std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+        snapshot_ = status;
+        snapshot_time_ = std::chrono::steady_clock::now();
+        snapshot_valid_ = true;
+    }
+
     return status;
 }
 
+messages::SystemStatus SystemInfo::getSnapshot(std::chrono::milliseconds& age) {
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        if (snapshot_valid_ &&
+            now - snapshot_time_ <= std::chrono::milliseconds(config::SYSTEM_STATUS_MAX_AGE_MS)) {
+            age = std::chrono::duration_cast<std::chrono::milliseconds>(now - snapshot_time_);
+            return snapshot_;
+        }
+    }
+
+    // Nothing refreshing it (e.g. broadcaster not started yet)
+    age = std::chrono::milliseconds(0);
+    return getStatus();
+}
+
 int64_t SystemInfo::getUptimeSeconds() {
     try {
         std::string content = readFile("/proc/uptime");
@@ -4,13 +4,20 @@
 #include <cstdint>
 #include <string>
 #include <chrono>
+#include <mutex>
 #include "protocol/messages.h"
 
 class SystemInfo {
 public:
-    // Get current system status
+    // Get current system status (reads /proc; also becomes the snapshot)
     static messages::SystemStatus getStatus();
 
+    // Latest status read by getStatus() - the status broadcaster refreshes it
+    // every STATUS_INTERVAL_MS - without touching /proc. Reads afresh only if
+    // there is none yet or it is older than SYSTEM_STATUS_MAX_AGE_MS.
+    // age is set to how old the returned status is.
+    static messages::SystemStatus getSnapshot(std::chrono::milliseconds& age);
+
 private:
     // Individual metric readers
     static int64_t getUptimeSeconds();
@@ -43,6 +50,15 @@ private:
     };
     static CPUStats last_cpu_stats_;
     static bool cpu_stats_initialized_;
+
+    // getStatus() is called from the status broadcaster and command workers
+    static std::mutex status_mutex_;
+
+    // Last getStatus() result; separate lock so readers never wait on /proc
+    static std::mutex snapshot_mutex_;
+    static messages::SystemStatus snapshot_;
+    static std::chrono::steady_clock::time_point snapshot_time_;
+    static bool snapshot_valid_;
 };
 
 #endif // SYSTEM_INFO_H